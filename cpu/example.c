@@ -8,6 +8,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "fimd_cpu.h"
 
@@ -30,7 +31,8 @@ int main(int argc, char *argv[]) {
     // Allocate memory for the image
     unsigned image_width = fimd_cpu_image_width();
     unsigned image_height = fimd_cpu_image_height();
-    unsigned image_size_bytes = image_width * image_height * sizeof(unsigned char);
+    unsigned image_stride = fimd_cpu_image_stride();
+    unsigned image_size_bytes = image_stride * image_height * sizeof(unsigned char);
     unsigned char* image_data = (unsigned char *) malloc(image_size_bytes);
     if (!image_data) {
         perror("Error when allocating memory");
@@ -38,8 +40,12 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
-    // Read the image data
-    unsigned read_size = fread(image_data, sizeof(unsigned char), image_width * image_height, file);
+    // Read the image data (tightly packed rows in the file)
+    unsigned read_size = 0;
+    memset(image_data, 0, image_size_bytes);
+    for (unsigned row = 0; row < image_height; row++) {
+        read_size += fread(image_data + row * image_stride, sizeof(unsigned char), image_width, file);
+    }
     if (read_size != image_width * image_height) {
         fprintf(stderr, "Error when reading file\n");
         free(image_data);
@@ -55,22 +61,45 @@ int main(int argc, char *argv[]) {
     unsigned markers_num = 0;
     unsigned sun_pts_num = 0;
 
+    // Create the detector context (allocated once, reused for all detections)
+    fimd_cpu_ctx_t* ctx = fimd_cpu_ctx_create();
+    if (!ctx) {
+        perror("Error when creating detector context");
+        free(image_data);
+        return EXIT_FAILURE;
+    }
+
     // Run the detection algorithm for all available radii (must be compiled in the shared library!)
     for (unsigned i = 0; i < fimd_cpu_get_radii_count(); i++) {
         unsigned radius = fimd_cpu_get_radii()[i];
-        int result = fimd_cpu_detect(radius, image_data, markers, &markers_num, sun_pts, &sun_pts_num);
+        int result = fimd_cpu_ctx_detect(ctx, radius, image_data, markers, &markers_num, sun_pts, &sun_pts_num);
         if (result != 0) {
             fprintf(stderr, "FIMD-CPU r=%u: ERROR - Return code %d\n\r\n", radius, result);
         } else {
             printf("FIMD-CPU r=%u: detected %d marker(s), %d sun point(s).\nMarker(s): [", radius, markers_num, sun_pts_num);
-            for (int i = 0; i < markers_num; i++) {
-                printf("(%u,%u),", markers[i][0], markers[i][1]);
+            for (unsigned j = 0; j < markers_num; j++) {
+                printf("(%u,%u),", markers[j][0], markers[j][1]);
             }
             printf("%s]\n\r\n", markers_num > 0 ? "\b" : "");
         }
     }
 
+    // Run the fused detection for all radii in a single pass, each detection is tagged with the smallest matching radius
+    unsigned markers_fused[fimd_cpu_get_max_markers_count()][3];
+    unsigned sun_pts_fused[fimd_cpu_get_max_sun_points_count()][3];
+    int result = fimd_cpu_ctx_detect_fused(ctx, image_data, markers_fused, &markers_num, sun_pts_fused, &sun_pts_num);
+    if (result != 0) {
+        fprintf(stderr, "FIMD-CPU fused: ERROR - Return code %d\n\r\n", result);
+    } else {
+        printf("FIMD-CPU fused: detected %d marker(s), %d sun point(s).\nMarker(s): [", markers_num, sun_pts_num);
+        for (unsigned i = 0; i < markers_num; i++) {
+            printf("(%u,%u,r=%u),", markers_fused[i][0], markers_fused[i][1], markers_fused[i][2]);
+        }
+        printf("%s]\n\r\n", markers_num > 0 ? "\b" : "");
+    }
+
     // Free the allocated memory
+    fimd_cpu_ctx_destroy(ctx);
     free(image_data);
 
     return EXIT_SUCCESS;
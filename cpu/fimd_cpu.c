@@ -6,11 +6,24 @@
  * \copyright GNU Public License.
  */
 
+// posix_memalign() and POSIX threads are not a part of C99
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "fimd_cpu.h"
+#ifdef FIMD_JIT
+#include "fimd_jit.h"
+#endif
+#include "fimd_kernels.h"
+#include "fimd_pool.h"
+#include "fimd_scan.h"
+#include "fimd_simd.h"
+#include "fimd_thresholds.h"
 
 // Preprocessor macros to get function calls for each radius
 #define EVAL(...) EVAL1024(__VA_ARGS__)
@@ -26,6 +39,7 @@
 #define EVAL2(...) EVAL1(EVAL1(__VA_ARGS__))
 #define EVAL1(...) __VA_ARGS__
 #define EMPTY()
+#define COMMA() ,
 #define DEFER1(id) id EMPTY()
 #define DEFER2(id) id EMPTY EMPTY()()
 #define CAT(a, ...) a ## __VA_ARGS__
@@ -46,86 +60,1955 @@
 #define MAP_INNER(op,sep,cur_val, ...) op(cur_val) IF(HAS_ARGS(__VA_ARGS__))(sep() DEFER2(_MAP_INNER)()(op, sep, ##__VA_ARGS__))
 #define _MAP_INNER() MAP_INNER
 
-#define FIMD_FN_TEMPLATE(_r_) extern uint8_t* fimd_r ## _r_ (uint8_t* img_ptr, uintptr_t* markers, uint32_t* markers_num, uintptr_t* sun_pts, uint32_t* sun_pts_num);
-#define FIMD_SWITCH_TEMPLATE(_r_) case _r_: fimd_r ## _r_ (tmp, markers_ptrs, markers_num, sun_pts_ptrs, sun_pts_num); break;
+#define FIMD_KERNELS_TEMPLATE_ISA(_s_, _isa_) extern const fimd_kernel_set_t fimd_kernels_w ## _s_ ## _isa_;
+
+#ifdef FIMD_ISA_DISPATCH
+// Kernels compiled for each instruction set variant (see CMakeLists.txt)
+#define FIMD_KERNELS_TEMPLATE_scalar(_s_) FIMD_KERNELS_TEMPLATE_ISA(_s_, _scalar)
+#define FIMD_KERNELS_TEMPLATE_sse41(_s_) FIMD_KERNELS_TEMPLATE_ISA(_s_, _sse41)
+#define FIMD_KERNELS_TEMPLATE_avx2(_s_) FIMD_KERNELS_TEMPLATE_ISA(_s_, _avx2)
+#define FIMD_KERNELS_TEMPLATE_avx512(_s_) FIMD_KERNELS_TEMPLATE_ISA(_s_, _avx512)
+#define FIMD_SET_TEMPLATE_scalar(_s_) &fimd_kernels_w ## _s_ ## _scalar
+#define FIMD_SET_TEMPLATE_sse41(_s_) &fimd_kernels_w ## _s_ ## _sse41
+#define FIMD_SET_TEMPLATE_avx2(_s_) &fimd_kernels_w ## _s_ ## _avx2
+#define FIMD_SET_TEMPLATE_avx512(_s_) &fimd_kernels_w ## _s_ ## _avx512
 
-MAP(FIMD_FN_TEMPLATE, EMPTY, FIMD_RADII);
+MAP(FIMD_KERNELS_TEMPLATE_scalar, EMPTY, FIMD_STRIDES);
+MAP(FIMD_KERNELS_TEMPLATE_sse41, EMPTY, FIMD_STRIDES);
+MAP(FIMD_KERNELS_TEMPLATE_avx2, EMPTY, FIMD_STRIDES);
+MAP(FIMD_KERNELS_TEMPLATE_avx512, EMPTY, FIMD_STRIDES);
+#else
+// Kernels compiled for the instruction set given by the compiler flags
+#define FIMD_KERNELS_TEMPLATE(_s_) FIMD_KERNELS_TEMPLATE_ISA(_s_, )
+#define FIMD_SET_TEMPLATE(_s_) &fimd_kernels_w ## _s_
+
+MAP(FIMD_KERNELS_TEMPLATE, EMPTY, FIMD_STRIDES);
+#endif
 
 const uint32_t fimd_radii_list[FIMD_RADII_COUNT] = { FIMD_RADII };
 
+fimd_thresholds_t fimd_cpu_thresholds = { FIMD_THRESHOLD_CENTER, FIMD_THRESHOLD_DIFF, FIMD_THRESHOLD_SUN };
+
+// Image resolution served by the library (stride bytes per row, the padding columns [width, stride) are read as zero)
+struct fimd_cpu_resolution_s {
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+};
+
+// Resolutions given at the build time, the first one is the default (see CMakeLists.txt)
+static const struct fimd_cpu_resolution_s fimd_cpu_resolutions[FIMD_RESOLUTIONS_COUNT] = { FIMD_RESOLUTIONS };
+
+// Row pitches of the generated kernel sets (the resolutions with the same pitch share the kernels)
+static const uint32_t fimd_cpu_strides[FIMD_STRIDES_COUNT] = { FIMD_STRIDES };
+
+// Offset of the first central pixel for the given radius
+#define FIMD_OFFSET(_stride, _r) (((_stride) * (_r)) + (_r))
+
+// Alignment of the scratch frame owned by the detector context (cache line size)
+#define FIMD_FRAME_ALIGNMENT 64
+
+// Generated kernels compiled for a single instruction set (one set per row pitch, in the order of fimd_cpu_strides)
+struct fimd_cpu_isa_s {
+    const char* name;
+    const fimd_kernel_set_t* sets[FIMD_STRIDES_COUNT];
+};
+
+#ifdef FIMD_ISA_DISPATCH
+// Instruction set variants ordered from the most generic one
+static const struct fimd_cpu_isa_s fimd_cpu_isa_list[] = {
+    { "scalar", { MAP(FIMD_SET_TEMPLATE_scalar, COMMA, FIMD_STRIDES) } },
+    { "sse4.1", { MAP(FIMD_SET_TEMPLATE_sse41, COMMA, FIMD_STRIDES) } },
+    { "avx2", { MAP(FIMD_SET_TEMPLATE_avx2, COMMA, FIMD_STRIDES) } },
+    { "avx512", { MAP(FIMD_SET_TEMPLATE_avx512, COMMA, FIMD_STRIDES) } },
+};
+#else
+static const struct fimd_cpu_isa_s fimd_cpu_isa_list[] = {
+    { FIMD_SIMD_NAME, { MAP(FIMD_SET_TEMPLATE, COMMA, FIMD_STRIDES) } },
+};
+#endif
+
+#define FIMD_ISA_COUNT (sizeof(fimd_cpu_isa_list) / sizeof(fimd_cpu_isa_list[0]))
+
+// Instruction set variant used by all detections (selected once, see fimd_cpu_isa_init())
+static const struct fimd_cpu_isa_s* fimd_cpu_isa = NULL;
+static pthread_once_t fimd_cpu_isa_once = PTHREAD_ONCE_INIT;
+
+// Context of fimd_cpu_detect() for each calling thread (created by the first call, released when the thread exits)
+static pthread_key_t fimd_cpu_detect_key;
+static pthread_once_t fimd_cpu_detect_once = PTHREAD_ONCE_INIT;
+
+// Horizontal stripe of the image processed by a single thread
+struct fimd_cpu_stripe_s {
+    // copy of image pixels [begin - offset, end + offset + 1), i.e., including the halo rows
+    uint8_t* buffer;
+    // suppression bitmap of the worker thread for the read-only detection of several radii
+    uint8_t* suppressed;
+    // range of the central pixels [begin, end) processed in this stripe
+    uintptr_t begin;
+    uintptr_t end;
+    // address returned by the kernel
+    uint8_t* stop_ptr;
+    uint32_t markers_num;
+    uint32_t sun_pts_num;
+    uintptr_t markers_ptrs[FIMD_MAX_MARKERS_COUNT];
+    uintptr_t sun_pts_ptrs[FIMD_MAX_SUN_PTS_COUNT];
+};
+
+// Number of the 64-bit words of the bitmap of the columns with a sun point
+#define FIMD_SUN_COLUMNS_WORDS(_stride) (((_stride) + 63) / 64)
+
+struct fimd_cpu_sun_column_s {
+    uint32_t row;
+    // index of the blob + 1
+    uint32_t blob;
+};
+
+struct fimd_cpu_ctx_s {
+    // resolution of the images, their size in bytes and the index of the kernel set for the row pitch
+    // (FIMD_STRIDES_COUNT if no kernels were generated for the row pitch, only the emitted kernels are used)
+    struct fimd_cpu_resolution_s resolution;
+    uintptr_t image_size;
+    unsigned set_index;
+
+    uint8_t* frame;
+    // scratch frame with 16-bit pixels (allocated by the first detection with 16-bit pixels)
+    uint16_t* frame16;
+    // chunks of the rows with the central pixels above the threshold and the chunks to unpack for the detection
+    // in the packed frames, one bit per chunk (allocated by the first detection in a packed frame)
+    uint64_t* packed_centers;
+    uint64_t* packed_unpack;
+    // suppression bitmap of the bounded kernels (all bits are cleared between the detections)
+    uint8_t* suppressed;
+    // last sun point in each column of the image and its blob (aggregation of the sun points into blobs),
+    // the bitmap marks the columns with a valid sun point
+    struct fimd_cpu_sun_column_s* sun_columns;
+    uint64_t* sun_columns_set;
+
+    // known defects of the sensor (sorted pixel indices), zeroed in the copies of the frames
+    // and permanently suppressed in the bitmaps of the bounded kernels
+    uint32_t* defects;
+    unsigned defects_count;
+
+    // temporal mask of the sun regions: remaining number of detections for which the central pixels
+    // of each cell are skipped (cells of sun_mask_cell x sun_mask_cell pixels, disabled if NULL)
+    uint8_t* sun_mask;
+    unsigned sun_mask_cell;
+    unsigned sun_mask_cols;
+    unsigned sun_mask_rows;
+    unsigned sun_mask_hold;
+    unsigned sun_mask_active;
+    uintptr_t markers_ptrs[FIMD_MAX_MARKERS_COUNT];
+    uintptr_t sun_pts_ptrs[FIMD_MAX_SUN_PTS_COUNT];
+    uint8_t markers_radii[FIMD_MAX_MARKERS_COUNT];
+    uint8_t sun_pts_radii[FIMD_MAX_SUN_PTS_COUNT];
+    // coordinates of the detections of the bounded kernels
+    fimd_cpu_point_t markers_xy[FIMD_MAX_MARKERS_COUNT];
+    fimd_cpu_point_t sun_pts_xy[FIMD_MAX_SUN_PTS_COUNT];
+
+    // parallel detection (thread pool and stripes)
+    fimd_pool_t* pool;
+    unsigned stripes_count;
+    unsigned stripes_radius;
+    struct fimd_cpu_stripe_s* stripes;
+
+    // parameters of the current parallel detection
+    fimd_kernel_t job_kernel;
+    uintptr_t job_offset;
+    const uint8_t* job_img_ptr;
+    const unsigned* job_radii;
+    fimd_cpu_points_t* job_markers;
+    fimd_cpu_points_t* job_sun_pts;
+};
+
+struct fimd_cpu_batch_s {
+    fimd_pool_t* pool;
+    // detector context of each worker of the pool
+    fimd_cpu_ctx_t** contexts;
+    unsigned contexts_count;
+    // reservation of the space in the results arena
+    pthread_mutex_t lock;
+
+    // parameters of the current batch detection
+    const unsigned char* const* job_frames;
+    const unsigned* job_radii;
+    unsigned job_radii_count;
+    fimd_cpu_batch_results_t* job_results;
+    int job_overflow;
+};
+
+
+static int fimd_cpu_isa_supported(unsigned isa_index)
+{
+#ifdef FIMD_ISA_DISPATCH
+    __builtin_cpu_init();
+    switch (isa_index) {
+        case 0:
+            return 1;
+        case 1:
+            return __builtin_cpu_supports("sse4.1");
+        case 2:
+            return __builtin_cpu_supports("avx2");
+        case 3:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+        default:
+            return 0;
+    }
+#else
+    return isa_index == 0;
+#endif
+}
+
+static void fimd_cpu_isa_init()
+{
+    // the most specific instruction set supported by the CPU
+    unsigned isa_index = FIMD_ISA_COUNT - 1;
+    while (isa_index > 0 && !fimd_cpu_isa_supported(isa_index)) {
+        isa_index--;
+    }
+    fimd_cpu_isa = &fimd_cpu_isa_list[isa_index];
+}
+
+static const struct fimd_cpu_isa_s* fimd_cpu_get_isa_variant()
+{
+    pthread_once(&fimd_cpu_isa_once, fimd_cpu_isa_init);
+    return fimd_cpu_isa;
+}
+
+static int fimd_cpu_get_radius_index(unsigned radius)
+{
+    for (unsigned i = 0; i < FIMD_RADII_COUNT; i++) {
+        if (fimd_radii_list[i] == radius) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+static const fimd_kernel_set_t* fimd_cpu_get_kernel_set(const fimd_cpu_ctx_t* ctx)
+{
+    return (ctx->set_index < FIMD_STRIDES_COUNT) ? fimd_cpu_get_isa_variant()->sets[ctx->set_index] : NULL;
+}
+
+static fimd_kernel_t fimd_cpu_get_kernel(const fimd_cpu_ctx_t* ctx, unsigned radius)
+{
+    int index = fimd_cpu_get_radius_index(radius);
+    const fimd_kernel_set_t* set = fimd_cpu_get_kernel_set(ctx);
+    if (index >= 0 && set) {
+        return set->kernels[index];
+    }
+#ifdef FIMD_JIT
+    // radius or row pitch without generated kernels, the kernel is emitted at runtime for the current thresholds
+    if (radius >= 1 && 2*radius < ctx->resolution.height) {
+#ifdef FIMD_ISA_DISPATCH
+        // 32-pixel blocks when the AVX2 or AVX-512 variant is selected
+        unsigned simd_width = (fimd_cpu_get_isa_variant() >= &fimd_cpu_isa_list[2]) ? 32 : 16;
+#elif defined(__AVX2__)
+        unsigned simd_width = 32;
+#else
+        unsigned simd_width = 16;
+#endif
+        return fimd_jit_get_kernel(radius, ctx->resolution.stride, fimd_cpu_thresholds, simd_width);
+    }
+#endif
+    return NULL;
+}
+
+// ends the use of a kernel of fimd_cpu_get_kernel() (an emitted kernel is released from the cache only when unused)
+static void fimd_cpu_release_kernel(const fimd_cpu_ctx_t* ctx, unsigned radius, fimd_kernel_t kernel)
+{
+#ifdef FIMD_JIT
+    if (kernel && (fimd_cpu_get_radius_index(radius) < 0 || !fimd_cpu_get_kernel_set(ctx))) {
+        fimd_jit_release_kernel(kernel);
+    }
+#else
+    (void) ctx;
+    (void) radius;
+    (void) kernel;
+#endif
+}
+
+static fimd_kernel16_t fimd_cpu_get_kernel16(const fimd_cpu_ctx_t* ctx, unsigned radius)
+{
+    int index = fimd_cpu_get_radius_index(radius);
+    const fimd_kernel_set_t* set = fimd_cpu_get_kernel_set(ctx);
+    return (index < 0 || !set) ? NULL : set->kernels16[index];
+}
+
+static fimd_scan_kernel_t fimd_cpu_get_bounded_kernel(const fimd_cpu_ctx_t* ctx, unsigned radius)
+{
+    int index = fimd_cpu_get_radius_index(radius);
+    const fimd_kernel_set_t* set = fimd_cpu_get_kernel_set(ctx);
+    return (index < 0 || !set) ? NULL : set->bounded[index];
+}
+
+static void fimd_cpu_ptrs_to_coords(const uintptr_t* ptrs, unsigned ptrs_num, uintptr_t base, uint32_t stride, unsigned coords[][2])
+{
+    uintptr_t pos1d;
+    for (unsigned i = 0; i < ptrs_num; i++) {
+        pos1d = ptrs[i] - base;
+        coords[i][1] = pos1d / stride;
+        coords[i][0] = pos1d % stride;
+    }
+}
+
+static void fimd_cpu_ptrs_to_points(const uintptr_t* ptrs, unsigned ptrs_num, uintptr_t base, uint32_t stride, fimd_cpu_point_t* points)
+{
+    uintptr_t pos1d;
+    for (unsigned i = 0; i < ptrs_num; i++) {
+        pos1d = ptrs[i] - base;
+        points[i].y = (uint16_t) (pos1d / stride);
+        points[i].x = (uint16_t) (pos1d % stride);
+    }
+}
+
+static void fimd_cpu_points_to_coords(const fimd_cpu_point_t* points, unsigned points_num, unsigned coords[][2])
+{
+    for (unsigned i = 0; i < points_num; i++) {
+        coords[i][0] = points[i].x;
+        coords[i][1] = points[i].y;
+    }
+}
+
+static uint32_t fimd_cpu_points_free(const fimd_cpu_points_t* points, uint32_t limit)
+{
+    uint32_t free_num = (points->count < points->capacity) ? (points->capacity - points->count) : 0;
+    return (free_num < limit) ? free_num : limit;
+}
+
+static void fimd_cpu_zero_padding(const struct fimd_cpu_resolution_s* res, uint8_t* buffer, uintptr_t first, uintptr_t size)
+{
+    if (res->stride == res->width) {
+        return;
+    }
+    // buffer holds the image bytes [first, first + size), the padding columns are zeroed (never pass the threshold)
+    uintptr_t last = first + size;
+    for (uintptr_t row_begin = (first / res->stride) * res->stride; row_begin < last; row_begin += res->stride) {
+        uintptr_t pad_begin = (row_begin + res->width > first) ? (row_begin + res->width) : first;
+        uintptr_t pad_end = (row_begin + res->stride < last) ? (row_begin + res->stride) : last;
+        if (pad_begin < pad_end) {
+            memset(buffer + (pad_begin - first), 0, pad_end - pad_begin);
+        }
+    }
+}
+
+static void fimd_cpu_copy_pixels(const struct fimd_cpu_resolution_s* res, uint8_t* buffer, const uint8_t* img_ptr, uintptr_t first, uintptr_t size)
+{
+    memcpy(buffer, img_ptr + first, size);
+    fimd_cpu_zero_padding(res, buffer, first, size);
+}
+
+static int fimd_cpu_pixels_differ(const struct fimd_cpu_resolution_s* res, const uint8_t* buffer, const uint8_t* img_ptr, uintptr_t first, uintptr_t size)
+{
+    if (res->stride == res->width) {
+        return memcmp(buffer, img_ptr + first, size) != 0;
+    }
+    // compare the pixels only, the padding columns of the buffer are zeroed
+    uintptr_t last = first + size;
+    for (uintptr_t row_begin = (first / res->stride) * res->stride; row_begin < last; row_begin += res->stride) {
+        uintptr_t pix_begin = (row_begin > first) ? row_begin : first;
+        uintptr_t pix_end = (row_begin + res->width < last) ? (row_begin + res->width) : last;
+        if (pix_begin < pix_end && memcmp(buffer + (pix_begin - first), img_ptr + pix_begin, pix_end - pix_begin) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void fimd_cpu_suppress_padding(const struct fimd_cpu_resolution_s* res, uint8_t* bitmap, uintptr_t first, uintptr_t last)
+{
+    if (res->stride == res->width) {
+        return;
+    }
+    // the padding columns are permanently suppressed in the bitmap of the bounded kernels (read as zero)
+    for (uintptr_t row_begin = (first / res->stride) * res->stride; row_begin < last; row_begin += res->stride) {
+        for (uintptr_t index = row_begin + res->width; index < row_begin + res->stride && index < last; index++) {
+            if (index >= first) {
+                FIMD_SCAN_SUPPRESS(bitmap, index);
+            }
+        }
+    }
+}
+
+// index of the first defect at or after the given pixel index (binary search)
+static unsigned fimd_cpu_defects_lower(const fimd_cpu_ctx_t* ctx, uintptr_t index)
+{
+    unsigned lo = 0;
+    unsigned hi = ctx->defects_count;
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        if (ctx->defects[mid] < index) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void fimd_cpu_zero_defects(const fimd_cpu_ctx_t* ctx, uint8_t* buffer, uintptr_t first, uintptr_t size)
+{
+    // buffer holds the image bytes [first, first + size), the defects are zeroed (never pass the threshold)
+    for (unsigned i = fimd_cpu_defects_lower(ctx, first); i < ctx->defects_count && ctx->defects[i] < first + size; i++) {
+        buffer[ctx->defects[i] - first] = 0;
+    }
+}
+
+static void fimd_cpu_suppress_defects(const fimd_cpu_ctx_t* ctx, uint8_t* bitmap, uintptr_t first, uintptr_t last)
+{
+    for (unsigned i = fimd_cpu_defects_lower(ctx, first); i < ctx->defects_count && ctx->defects[i] < last; i++) {
+        FIMD_SCAN_SUPPRESS(bitmap, ctx->defects[i]);
+    }
+}
+
+// checks whether the zeroed halo rows of a stripe differ from the image in any pixel other than the defects
+static int fimd_cpu_halo_differs(const fimd_cpu_ctx_t* ctx, const uint8_t* buffer, const uint8_t* img_ptr, uintptr_t first, uintptr_t size)
+{
+    if (!fimd_cpu_pixels_differ(&ctx->resolution, buffer, img_ptr, first, size)) {
+        return 0;
+    }
+    if (ctx->defects_count == 0) {
+        return 1;
+    }
+    unsigned d = fimd_cpu_defects_lower(ctx, first);
+    for (uintptr_t index = first; index < first + size; index++) {
+        while (d < ctx->defects_count && ctx->defects[d] < index) {
+            d++;
+        }
+        int defect = d < ctx->defects_count && ctx->defects[d] == index;
+        if (buffer[index - first] != img_ptr[index] && !defect && (index % ctx->resolution.stride) < ctx->resolution.width) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void fimd_cpu_detect_key_destroy(void* ctx)
+{
+    fimd_cpu_ctx_destroy((fimd_cpu_ctx_t*) ctx);
+}
+
+static void fimd_cpu_detect_key_init(void)
+{
+    pthread_key_create(&fimd_cpu_detect_key, fimd_cpu_detect_key_destroy);
+}
 
 int fimd_cpu_detect(unsigned radius, const unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num)
 {
-    uint32_t image_size = IM_WIDTH * IM_HEIGHT * sizeof(uint8_t);
-    uint8_t* tmp = (uint8_t *) malloc(image_size);
-    if (!tmp) {
-        return -1; // Memory allocation error
+    // the context is kept between the calls, so the frames are detected without any allocation
+    pthread_once(&fimd_cpu_detect_once, fimd_cpu_detect_key_init);
+    fimd_cpu_ctx_t* ctx = (fimd_cpu_ctx_t*) pthread_getspecific(fimd_cpu_detect_key);
+    if (!ctx) {
+        ctx = fimd_cpu_ctx_create();
+        if (!ctx || pthread_setspecific(fimd_cpu_detect_key, ctx) != 0) {
+            fimd_cpu_ctx_destroy(ctx);
+            return -1; // Memory allocation error
+        }
     }
-    memcpy(tmp, img_ptr, image_size);
 
-    uintptr_t markers_ptrs[FIMD_MAX_MARKERS_COUNT];
-    uintptr_t sun_pts_ptrs[FIMD_MAX_SUN_PTS_COUNT];
+    return fimd_cpu_ctx_detect(ctx, radius, img_ptr, markers, markers_num, sun_pts, sun_pts_num);
+}
+
+fimd_cpu_ctx_t* fimd_cpu_ctx_create()
+{
+    return fimd_cpu_ctx_create_resolution(fimd_cpu_resolutions[0].width, fimd_cpu_resolutions[0].height, fimd_cpu_resolutions[0].stride);
+}
+
+fimd_cpu_ctx_t* fimd_cpu_ctx_create_resolution(unsigned width, unsigned height, unsigned stride)
+{
+    // the first resolution given at the build time matches if the row pitch is not specified
+    const struct fimd_cpu_resolution_s* resolution = NULL;
+    for (unsigned i = 0; i < FIMD_RESOLUTIONS_COUNT && !resolution; i++) {
+        if (fimd_cpu_resolutions[i].width == width && fimd_cpu_resolutions[i].height == height && (stride == 0 || fimd_cpu_resolutions[i].stride == stride)) {
+            resolution = &fimd_cpu_resolutions[i];
+        }
+    }
+#ifdef FIMD_JIT
+    // any other resolution is served by the kernels emitted at runtime
+    struct fimd_cpu_resolution_s emitted = { width, height, (stride == 0) ? width : stride };
+    if (!resolution && width > 0 && height > 0 && emitted.stride >= width && (uint64_t) emitted.stride * height <= UINT32_MAX) {
+        resolution = &emitted;
+    }
+#endif
+    if (!resolution) {
+        return NULL; // Resolution not supported
+    }
+
+    fimd_cpu_ctx_t* ctx = (fimd_cpu_ctx_t*) malloc(sizeof(struct fimd_cpu_ctx_s));
+    if (!ctx) {
+        return NULL;
+    }
+
+    ctx->resolution = *resolution;
+    ctx->image_size = (uintptr_t) resolution->stride * resolution->height * sizeof(uint8_t);
+    ctx->set_index = 0;
+    while (ctx->set_index < FIMD_STRIDES_COUNT && fimd_cpu_strides[ctx->set_index] != resolution->stride) {
+        ctx->set_index++;
+    }
+
+    if (posix_memalign((void**) &ctx->frame, FIMD_FRAME_ALIGNMENT, ctx->image_size) != 0) {
+        free(ctx);
+        return NULL;
+    }
+
+    ctx->suppressed = (uint8_t*) calloc(FIMD_SCAN_BITMAP_SIZE(ctx->image_size) + FIMD_SCAN_BITMAP_PADDING, sizeof(uint8_t));
+    ctx->sun_columns = (struct fimd_cpu_sun_column_s*) calloc(ctx->resolution.stride, sizeof(struct fimd_cpu_sun_column_s));
+    ctx->sun_columns_set = (uint64_t*) calloc(FIMD_SUN_COLUMNS_WORDS(ctx->resolution.stride), sizeof(uint64_t));
+    if (!ctx->suppressed || !ctx->sun_columns || !ctx->sun_columns_set) {
+        free(ctx->sun_columns_set);
+        free(ctx->sun_columns);
+        free(ctx->suppressed);
+        free(ctx->frame);
+        free(ctx);
+        return NULL;
+    }
+
+    // touch all pages in advance, so that no page faults occur during the detection
+    memset(ctx->frame, 0, ctx->image_size);
+    memset(ctx->suppressed, 0, FIMD_SCAN_BITMAP_SIZE(ctx->image_size) + FIMD_SCAN_BITMAP_PADDING);
+    fimd_cpu_suppress_padding(&ctx->resolution, ctx->suppressed, 0, ctx->image_size);
+    memset(ctx->markers_ptrs, 0, sizeof(ctx->markers_ptrs));
+    memset(ctx->sun_pts_ptrs, 0, sizeof(ctx->sun_pts_ptrs));
+    memset(ctx->markers_radii, 0, sizeof(ctx->markers_radii));
+    memset(ctx->sun_pts_radii, 0, sizeof(ctx->sun_pts_radii));
+    memset(ctx->markers_xy, 0, sizeof(ctx->markers_xy));
+    memset(ctx->sun_pts_xy, 0, sizeof(ctx->sun_pts_xy));
+
+    ctx->frame16 = NULL;
+    ctx->packed_centers = NULL;
+    ctx->packed_unpack = NULL;
+
+    ctx->defects = NULL;
+    ctx->defects_count = 0;
+
+    ctx->sun_mask = NULL;
+    ctx->sun_mask_cell = 0;
+    ctx->sun_mask_cols = 0;
+    ctx->sun_mask_rows = 0;
+    ctx->sun_mask_hold = 0;
+    ctx->sun_mask_active = 0;
+
+    ctx->pool = NULL;
+    ctx->stripes_count = 0;
+    ctx->stripes_radius = 0;
+    ctx->stripes = NULL;
+
+    return ctx;
+}
+
+static int fimd_cpu_ctx_run(fimd_cpu_ctx_t* ctx, unsigned radius, uint8_t* frame, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num)
+{
     *markers_num = 0;
     *sun_pts_num = 0;
 
-    switch (radius) {
-        MAP(FIMD_SWITCH_TEMPLATE, EMPTY, FIMD_RADII)
-        default:
-            free(tmp);
-            return -2; // Invalid radius
+    fimd_kernel_t kernel = fimd_cpu_get_kernel(ctx, radius);
+    if (!kernel) {
+        return -2; // Invalid radius
     }
 
-    uintptr_t pos1d;
-    for (int i = 0; i < *markers_num; i++) {
-        pos1d = markers_ptrs[i] - ((uintptr_t) tmp);
-        markers[i][1] = pos1d / IM_WIDTH;
-        markers[i][0] = pos1d % IM_WIDTH;
+    // append termination sequence to image end
+    *((uint16_t*) (frame + ctx->image_size - 2)) = FIMD_TERM_SEQ;
+    kernel(frame, frame + ctx->image_size, ctx->markers_ptrs, markers_num, ctx->sun_pts_ptrs, sun_pts_num);
+    fimd_cpu_release_kernel(ctx, radius, kernel);
+
+    fimd_cpu_ptrs_to_coords(ctx->markers_ptrs, *markers_num, (uintptr_t) frame, ctx->resolution.stride, markers);
+    fimd_cpu_ptrs_to_coords(ctx->sun_pts_ptrs, *sun_pts_num, (uintptr_t) frame, ctx->resolution.stride, sun_pts);
+
+    return 0;
+}
+
+int fimd_cpu_ctx_detect(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num)
+{
+    fimd_cpu_copy_pixels(&ctx->resolution, ctx->frame, img_ptr, 0, ctx->image_size);
+    fimd_cpu_zero_defects(ctx, ctx->frame, 0, ctx->image_size);
+    return fimd_cpu_ctx_run(ctx, radius, ctx->frame, markers, markers_num, sun_pts, sun_pts_num);
+}
+
+int fimd_cpu_ctx_detect_inplace(fimd_cpu_ctx_t* ctx, unsigned radius, unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num)
+{
+    fimd_cpu_zero_padding(&ctx->resolution, img_ptr, 0, ctx->image_size);
+    fimd_cpu_zero_defects(ctx, img_ptr, 0, ctx->image_size);
+    return fimd_cpu_ctx_run(ctx, radius, img_ptr, markers, markers_num, sun_pts, sun_pts_num);
+}
+
+int fimd_cpu_ctx_detect16(fimd_cpu_ctx_t* ctx, unsigned radius, const uint16_t* img_ptr, unsigned bits, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num)
+{
+    *markers_num = 0;
+    *sun_pts_num = 0;
+
+    fimd_kernel16_t kernel = fimd_cpu_get_kernel16(ctx, radius);
+    if (!kernel || bits < 8 || bits > 16) {
+        return -2; // Invalid radius or pixel depth
+    }
+    if (!ctx->frame16 && posix_memalign((void**) &ctx->frame16, FIMD_FRAME_ALIGNMENT, ctx->image_size * sizeof(uint16_t)) != 0) {
+        ctx->frame16 = NULL;
+        return -1; // Memory allocation error
+    }
+
+    // copy of the pixels with the padding columns and the defects zeroed
+    uint16_t* frame = ctx->frame16;
+    memcpy(frame, img_ptr, ctx->image_size * sizeof(uint16_t));
+    for (uintptr_t row_begin = 0; row_begin < ctx->image_size && ctx->resolution.stride != ctx->resolution.width; row_begin += ctx->resolution.stride) {
+        memset(frame + row_begin + ctx->resolution.width, 0, (ctx->resolution.stride - ctx->resolution.width) * sizeof(uint16_t));
+    }
+    for (unsigned i = 0; i < ctx->defects_count; i++) {
+        frame[ctx->defects[i]] = 0;
     }
 
-    for (int i = 0; i < *sun_pts_num; i++) {
-        pos1d = sun_pts_ptrs[i] - ((uintptr_t) tmp);
-        sun_pts[i][1] = pos1d / IM_WIDTH;
-        sun_pts[i][0] = pos1d % IM_WIDTH;
+    // the thresholds of the 8-bit pixels scaled to the pixel depth, so the 8-bit data shifted left give the same results
+    unsigned shift = bits - 8;
+    fimd_thresholds16_t thresholds = {
+        (uint16_t) (fimd_cpu_thresholds.center << shift),
+        (uint16_t) (fimd_cpu_thresholds.diff << shift),
+        (uint16_t) (fimd_cpu_thresholds.sun << shift)
+    };
+
+    // append termination sequence to image end
+    *((uint32_t*) (frame + ctx->image_size - 2)) = FIMD_TERM_SEQ16;
+    kernel(frame, frame + ctx->image_size, &thresholds, ctx->markers_ptrs, markers_num, ctx->sun_pts_ptrs, sun_pts_num);
+
+    // the detections are addresses of the 16-bit pixels
+    uint32_t stride_bytes = ctx->resolution.stride * sizeof(uint16_t);
+    for (unsigned i = 0; i < *markers_num; i++) {
+        uintptr_t pos1d = ctx->markers_ptrs[i] - (uintptr_t) frame;
+        markers[i][1] = pos1d / stride_bytes;
+        markers[i][0] = (pos1d % stride_bytes) / sizeof(uint16_t);
+    }
+    for (unsigned i = 0; i < *sun_pts_num; i++) {
+        uintptr_t pos1d = ctx->sun_pts_ptrs[i] - (uintptr_t) frame;
+        sun_pts[i][1] = pos1d / stride_bytes;
+        sun_pts[i][0] = (pos1d % stride_bytes) / sizeof(uint16_t);
     }
 
-    free(tmp);
     return 0;
 }
 
-const unsigned fimd_cpu_image_width() {
-    return IM_WIDTH;
+static void fimd_cpu_scan_init(fimd_cpu_ctx_t* ctx, fimd_scan_t* scan, const uint8_t* img_ptr)
+{
+    scan->img = img_ptr;
+    scan->begin = img_ptr;
+    scan->end = img_ptr;
+    scan->read_end = img_ptr + ctx->image_size;
+    scan->suppressed = ctx->suppressed;
+    // suppressed padding columns in all rows and the defects
+    scan->suppressed_begin = 0;
+    scan->suppressed_end = (ctx->resolution.stride != ctx->resolution.width) ? ctx->image_size : 0;
+    if (ctx->defects_count > 0 && scan->suppressed_end == 0) {
+        scan->suppressed_begin = ctx->defects[0];
+        scan->suppressed_end = ctx->defects[ctx->defects_count - 1] + 1;
+    }
+    scan->markers = ctx->markers_xy;
+    scan->centroids = NULL;
+    scan->markers_num = 0;
+    scan->markers_max = FIMD_MAX_MARKERS_COUNT;
+    scan->sun_pts = ctx->sun_pts_xy;
+    scan->sun_pts_num = 0;
+    scan->sun_pts_max = FIMD_MAX_SUN_PTS_COUNT;
 }
 
-const unsigned fimd_cpu_image_height() {
-    return IM_HEIGHT;
+static void fimd_cpu_scan_release(fimd_cpu_ctx_t* ctx, fimd_scan_t* scan)
+{
+    // clear only the part of the bitmap touched by the scan
+    if (scan->suppressed_begin != scan->suppressed_end) {
+        uintptr_t first = scan->suppressed_begin >> 3;
+        uintptr_t last = (scan->suppressed_end + 7) >> 3;
+        if (last > FIMD_SCAN_BITMAP_SIZE(ctx->image_size)) {
+            last = FIMD_SCAN_BITMAP_SIZE(ctx->image_size);
+        }
+        memset(scan->suppressed + first, 0, last - first);
+        fimd_cpu_suppress_padding(&ctx->resolution, scan->suppressed, first << 3, last << 3);
+        fimd_cpu_suppress_defects(ctx, scan->suppressed, first << 3, last << 3);
+    }
+    scan->suppressed_begin = 0;
+    scan->suppressed_end = 0;
 }
 
-const unsigned fimd_cpu_get_radii_count() {
-    return FIMD_RADII_COUNT;
+static int fimd_cpu_compare_defects(const void* a, const void* b)
+{
+    uint32_t index_a = *((const uint32_t*) a);
+    uint32_t index_b = *((const uint32_t*) b);
+    return (index_a > index_b) - (index_a < index_b);
 }
 
-const unsigned* fimd_cpu_get_radii() {
-    return fimd_radii_list;
+// replaces the defects of the context by the given pixel indices (sorted and deduplicated here)
+static void fimd_cpu_ctx_apply_defects(fimd_cpu_ctx_t* ctx, uint32_t* defects, unsigned defects_count)
+{
+    qsort(defects, defects_count, sizeof(uint32_t), fimd_cpu_compare_defects);
+    unsigned count = 0;
+    for (unsigned i = 0; i < defects_count; i++) {
+        if (count == 0 || defects[count - 1] != defects[i]) {
+            defects[count++] = defects[i];
+        }
+    }
+
+    free(ctx->defects);
+    ctx->defects = defects;
+    ctx->defects_count = count;
+
+    // rebuild the permanently suppressed pixels of all bitmaps
+    size_t bitmap_size = FIMD_SCAN_BITMAP_SIZE(ctx->image_size) + FIMD_SCAN_BITMAP_PADDING;
+    memset(ctx->suppressed, 0, bitmap_size);
+    fimd_cpu_suppress_padding(&ctx->resolution, ctx->suppressed, 0, ctx->image_size);
+    fimd_cpu_suppress_defects(ctx, ctx->suppressed, 0, ctx->image_size);
+    for (unsigned i = 0; i < ctx->stripes_count; i++) {
+        memset(ctx->stripes[i].suppressed, 0, bitmap_size);
+        fimd_cpu_suppress_padding(&ctx->resolution, ctx->stripes[i].suppressed, 0, ctx->image_size);
+        fimd_cpu_suppress_defects(ctx, ctx->stripes[i].suppressed, 0, ctx->image_size);
+    }
 }
 
-const unsigned fimd_cpu_get_max_markers_count() {
-    return FIMD_MAX_MARKERS_COUNT;
+int fimd_cpu_ctx_set_defects(fimd_cpu_ctx_t* ctx, const unsigned defects[][2], unsigned defects_count)
+{
+    for (unsigned i = 0; i < defects_count; i++) {
+        if (defects[i][0] >= ctx->resolution.width || defects[i][1] >= ctx->resolution.height) {
+            return -2; // Invalid coordinates
+        }
+    }
+
+    uint32_t* indices = (uint32_t*) malloc((defects_count + 1) * sizeof(uint32_t));
+    if (!indices) {
+        return -1; // Memory allocation error
+    }
+    for (unsigned i = 0; i < defects_count; i++) {
+        indices[i] = defects[i][1] * ctx->resolution.stride + defects[i][0];
+    }
+    fimd_cpu_ctx_apply_defects(ctx, indices, defects_count);
+
+    return 0;
 }
 
-const unsigned fimd_cpu_get_max_sun_points_count() {
-    return FIMD_MAX_SUN_PTS_COUNT;
+int fimd_cpu_ctx_set_defect_map(fimd_cpu_ctx_t* ctx, const uint8_t* bitmap)
+{
+    unsigned pixels_count = ctx->resolution.width * ctx->resolution.height;
+    unsigned defects_count = 0;
+    for (unsigned i = 0; bitmap && i < pixels_count; i++) {
+        defects_count += (bitmap[i >> 3] >> (i & 7)) & 1;
+    }
+
+    uint32_t* indices = (uint32_t*) malloc((defects_count + 1) * sizeof(uint32_t));
+    if (!indices) {
+        return -1; // Memory allocation error
+    }
+    unsigned count = 0;
+    for (unsigned i = 0; bitmap && i < pixels_count; i++) {
+        if ((bitmap[i >> 3] >> (i & 7)) & 1) {
+            indices[count++] = (i / ctx->resolution.width) * ctx->resolution.stride + (i % ctx->resolution.width);
+        }
+    }
+    fimd_cpu_ctx_apply_defects(ctx, indices, count);
+
+    return 0;
 }
 
-const unsigned fimd_cpu_get_threshold_marker() {
-    return FIMD_THRESHOLD_CENTER;
+int fimd_cpu_ctx_set_sun_mask(fimd_cpu_ctx_t* ctx, unsigned cell_size, unsigned hold_count)
+{
+    free(ctx->sun_mask);
+    ctx->sun_mask = NULL;
+    ctx->sun_mask_active = 0;
+    if (hold_count == 0) {
+        return 0;
+    }
+    if (cell_size == 0 || hold_count > UINT8_MAX) {
+        return -2; // Invalid parameters
+    }
+
+    ctx->sun_mask_cell = cell_size;
+    ctx->sun_mask_cols = (ctx->resolution.width + cell_size - 1) / cell_size;
+    ctx->sun_mask_rows = (ctx->resolution.height + cell_size - 1) / cell_size;
+    ctx->sun_mask_hold = hold_count;
+    ctx->sun_mask = (uint8_t*) calloc(ctx->sun_mask_cols * ctx->sun_mask_rows, sizeof(uint8_t));
+    if (!ctx->sun_mask) {
+        return -1; // Memory allocation error
+    }
+
+    return 0;
 }
 
-const unsigned fimd_cpu_get_threshold_sun() {
-    return FIMD_THRESHOLD_SUN;
+const uint8_t* fimd_cpu_ctx_get_sun_mask(const fimd_cpu_ctx_t* ctx, unsigned* cols, unsigned* rows)
+{
+    *cols = (ctx->sun_mask) ? ctx->sun_mask_cols : 0;
+    *rows = (ctx->sun_mask) ? ctx->sun_mask_rows : 0;
+    return ctx->sun_mask;
 }
 
-const unsigned fimd_cpu_get_threshold_diff() {
-    return FIMD_THRESHOLD_DIFF;
+// runs the bounded kernel on the central pixels [begin, end) of the scan except for the cells of the sun mask,
+// the unmasked pixels form contiguous spans in the scan order (across the row ends as in the full frame scan)
+static void fimd_cpu_scan_masked(const fimd_cpu_ctx_t* ctx, fimd_scan_kernel_t kernel, fimd_scan_t* scan)
+{
+    const uint8_t* span = scan->begin;
+    const uint8_t* end = scan->end;
+    uint32_t stride = ctx->resolution.stride;
+    unsigned cell = ctx->sun_mask_cell;
+
+    for (unsigned cy = 0; cy < ctx->sun_mask_rows && ctx->sun_mask_active > 0; cy++) {
+        const uint8_t* mask_row = ctx->sun_mask + cy * ctx->sun_mask_cols;
+        int masked = 0;
+        for (unsigned cx = 0; cx < ctx->sun_mask_cols && !masked; cx++) {
+            masked = mask_row[cx] != 0;
+        }
+        if (!masked) {
+            continue;
+        }
+
+        unsigned y_last = (cy + 1) * cell;
+        if (y_last > ctx->resolution.height) {
+            y_last = ctx->resolution.height;
+        }
+        for (unsigned y = cy * cell; y < y_last; y++) {
+            for (unsigned cx = 0; cx < ctx->sun_mask_cols; cx++) {
+                if (mask_row[cx] == 0) {
+                    continue;
+                }
+                // adjacent masked cells are skipped at once
+                unsigned x0 = cx * cell;
+                while (cx + 1 < ctx->sun_mask_cols && mask_row[cx + 1] != 0) {
+                    cx++;
+                }
+                unsigned x1 = (cx + 1) * cell;
+                if (x1 > ctx->resolution.width) {
+                    x1 = ctx->resolution.width;
+                }
+
+                const uint8_t* skip_begin = scan->img + (uintptr_t) y * stride + x0;
+                const uint8_t* skip_end = scan->img + (uintptr_t) y * stride + x1;
+                if (skip_begin >= end) {
+                    goto TAIL;
+                }
+                if (skip_begin > span) {
+                    scan->begin = span;
+                    scan->end = skip_begin;
+                    if (kernel(scan) != skip_begin) {
+                        return; // limit reached
+                    }
+                }
+                if (skip_end > span) {
+                    span = skip_end;
+                }
+            }
+        }
+    }
+
+TAIL:
+    if (span < end) {
+        scan->begin = span;
+        scan->end = end;
+        kernel(scan);
+    }
+}
+
+// ages the cells of the sun mask by one detection and masks the cells of the new sun points
+static void fimd_cpu_sun_mask_update(fimd_cpu_ctx_t* ctx, const fimd_cpu_point_t* sun_pts, unsigned sun_pts_num)
+{
+    unsigned cells_count = ctx->sun_mask_cols * ctx->sun_mask_rows;
+    for (unsigned i = 0; i < cells_count && ctx->sun_mask_active > 0; i++) {
+        if (ctx->sun_mask[i] > 0 && --ctx->sun_mask[i] == 0) {
+            ctx->sun_mask_active--;
+        }
+    }
+
+    for (unsigned i = 0; i < sun_pts_num; i++) {
+        uint8_t* cell = &ctx->sun_mask[(sun_pts[i].y / ctx->sun_mask_cell) * ctx->sun_mask_cols + sun_pts[i].x / ctx->sun_mask_cell];
+        if (*cell == 0) {
+            ctx->sun_mask_active++;
+        }
+        *cell = (uint8_t) ctx->sun_mask_hold;
+    }
+}
+
+// scans all central pixels of a read-only image with the bitmap and the sun mask of the context
+static int fimd_cpu_scan_const(fimd_cpu_ctx_t* ctx, unsigned radius, const uint8_t* img_ptr, fimd_cpu_centroid_t* centroids, fimd_scan_t* scan)
+{
+    fimd_scan_kernel_t kernel = fimd_cpu_get_bounded_kernel(ctx, radius);
+    if (!kernel) {
+        return -2; // Invalid radius
+    }
+
+    // the same range of the central pixels as for the whole frame with the termination sequence
+    fimd_cpu_scan_init(ctx, scan, img_ptr);
+    scan->centroids = centroids;
+    scan->begin = img_ptr + FIMD_OFFSET(ctx->resolution.stride, radius);
+    scan->end = img_ptr + ctx->image_size - 1 - FIMD_OFFSET(ctx->resolution.stride, radius);
+    if (ctx->sun_mask) {
+        fimd_cpu_scan_masked(ctx, kernel, scan);
+        fimd_cpu_sun_mask_update(ctx, scan->sun_pts, scan->sun_pts_num);
+    } else {
+        kernel(scan);
+    }
+    fimd_cpu_scan_release(ctx, scan);
+
+    return 0;
+}
+
+int fimd_cpu_ctx_detect_const(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num)
+{
+    *markers_num = 0;
+    *sun_pts_num = 0;
+
+    fimd_scan_t scan;
+    int result = fimd_cpu_scan_const(ctx, radius, img_ptr, NULL, &scan);
+    if (result != 0) {
+        return result;
+    }
+
+    *markers_num = scan.markers_num;
+    *sun_pts_num = scan.sun_pts_num;
+    fimd_cpu_points_to_coords(ctx->markers_xy, *markers_num, markers);
+    fimd_cpu_points_to_coords(ctx->sun_pts_xy, *sun_pts_num, sun_pts);
+
+    return 0;
+}
+
+int fimd_cpu_ctx_detect_centroids(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, fimd_cpu_centroid_t markers[], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num)
+{
+    *markers_num = 0;
+    *sun_pts_num = 0;
+
+    // the kernel writes the centroids (including the peaks) directly into the caller's array
+    fimd_scan_t scan;
+    int result = fimd_cpu_scan_const(ctx, radius, img_ptr, markers, &scan);
+    if (result != 0) {
+        return result;
+    }
+
+    *markers_num = scan.markers_num;
+    *sun_pts_num = scan.sun_pts_num;
+    fimd_cpu_points_to_coords(ctx->sun_pts_xy, *sun_pts_num, sun_pts);
+
+    return 0;
+}
+
+// scans all central pixels of a read-only image with the given suppression bitmap, appends to the caller's buffers
+static int fimd_cpu_scan_points(fimd_cpu_ctx_t* ctx, unsigned radius, const uint8_t* img_ptr, uint8_t* suppressed, int masked, fimd_cpu_points_t* markers, fimd_cpu_points_t* sun_pts)
+{
+    fimd_scan_kernel_t kernel = fimd_cpu_get_bounded_kernel(ctx, radius);
+    if (!kernel) {
+        return -2; // Invalid radius
+    }
+
+    // the kernel appends directly to the free space of the caller's buffers
+    fimd_scan_t scan;
+    fimd_cpu_scan_init(ctx, &scan, img_ptr);
+    scan.suppressed = suppressed;
+    scan.begin = img_ptr + FIMD_OFFSET(ctx->resolution.stride, radius);
+    scan.end = img_ptr + ctx->image_size - 1 - FIMD_OFFSET(ctx->resolution.stride, radius);
+    scan.markers = markers->data + markers->count;
+    scan.markers_max = fimd_cpu_points_free(markers, FIMD_MAX_MARKERS_COUNT);
+    scan.sun_pts = sun_pts->data + sun_pts->count;
+    scan.sun_pts_max = fimd_cpu_points_free(sun_pts, FIMD_MAX_SUN_PTS_COUNT);
+    if (masked && ctx->sun_mask) {
+        fimd_cpu_scan_masked(ctx, kernel, &scan);
+        fimd_cpu_sun_mask_update(ctx, scan.sun_pts, scan.sun_pts_num);
+    } else {
+        kernel(&scan);
+    }
+    fimd_cpu_scan_release(ctx, &scan);
+
+    markers->count += scan.markers_num;
+    sun_pts->count += scan.sun_pts_num;
+
+    return 0;
+}
+
+int fimd_cpu_ctx_detect_points(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, fimd_cpu_points_t* markers, fimd_cpu_points_t* sun_pts)
+{
+    return fimd_cpu_scan_points(ctx, radius, img_ptr, ctx->suppressed, 1, markers, sun_pts);
+}
+
+// Number of the sun points aggregated into the blobs at once (the scan continues after each full chunk)
+#define FIMD_BLOB_CHUNK_COUNT 256
+
+// merges the blob src into the older blob dst (src is emptied and its columns are relabeled)
+static void fimd_cpu_blob_merge(struct fimd_cpu_sun_column_s* columns, fimd_cpu_sun_blob_t* blobs, unsigned dst_index, unsigned src_index)
+{
+    fimd_cpu_sun_blob_t* dst = &blobs[dst_index];
+    fimd_cpu_sun_blob_t* src = &blobs[src_index];
+    dst->count += src->count;
+    dst->x_sum += src->x_sum;
+    dst->y_sum += src->y_sum;
+    if (src->x_min < dst->x_min) dst->x_min = src->x_min;
+    if (src->y_min < dst->y_min) dst->y_min = src->y_min;
+    if (src->x_max > dst->x_max) dst->x_max = src->x_max;
+    if (src->y_max > dst->y_max) dst->y_max = src->y_max;
+    src->count = 0;
+
+    // all columns of the sun points of src lie within its bounding box
+    for (unsigned x = src->x_min; x <= src->x_max; x++) {
+        if (columns[x].blob == src_index + 1) {
+            columns[x].blob = dst_index + 1;
+        }
+    }
+}
+
+// drops the blobs merged into the older ones, the order of the remaining blobs is kept (an older blob has a lower index)
+// and the columns of their sun points are relabeled (all columns of a blob lie within its bounding box)
+static void fimd_cpu_blobs_compact(struct fimd_cpu_sun_column_s* columns, fimd_cpu_sun_blob_t* blobs, unsigned* blobs_num)
+{
+    unsigned count = 0;
+    for (unsigned i = 0; i < *blobs_num; i++) {
+        if (blobs[i].count == 0) {
+            continue;
+        }
+        if (count != i) {
+            blobs[count] = blobs[i];
+            for (unsigned x = blobs[count].x_min; x <= blobs[count].x_max; x++) {
+                if (columns[x].blob == i + 1) {
+                    columns[x].blob = count + 1;
+                }
+            }
+        }
+        count++;
+    }
+    *blobs_num = count;
+}
+
+// streaming connected components of the sun points in the row order: a sun point joins all blobs with a sun point
+// at most dist pixels apart in both axes, only the last sun point of each column needs to be tested (the older ones
+// in the same column are already connected to it), the columns with a recent sun point are marked in a bitmap
+// (blobs_merged counts the blobs emptied by the merges, they are dropped when a new blob does not fit)
+static void fimd_cpu_blobs_add(struct fimd_cpu_sun_column_s* columns, uint64_t* columns_set, uint32_t width, fimd_cpu_sun_blob_t* blobs, unsigned* blobs_num, unsigned* blobs_merged, unsigned blobs_max, const fimd_cpu_point_t* points, unsigned points_num, unsigned dist)
+{
+    for (unsigned i = 0; i < points_num; i++) {
+        unsigned x = points[i].x;
+        unsigned y = points[i].y;
+        unsigned first = (x > dist) ? x - dist : 0;
+        unsigned last = (x + dist < width) ? x + dist : width - 1;
+
+        unsigned blob = 0;
+        for (unsigned w = first >> 6; w <= last >> 6; w++) {
+            uint64_t bits = columns_set[w];
+            if (w == first >> 6) bits &= ~0ULL << (first & 63);
+            if (w == last >> 6) bits &= ~0ULL >> (63 - (last & 63));
+            while (bits) {
+                unsigned c = (w << 6) + (unsigned) __builtin_ctzll(bits);
+                bits &= bits - 1;
+                unsigned other = columns[c].blob;
+                if (columns[c].row + dist < y) {
+                    columns_set[w] &= ~(1ULL << (c & 63)); // too old for all following sun points
+                    continue;
+                }
+                if (other == blob) {
+                    continue;
+                }
+                if (blob == 0) {
+                    blob = other;
+                } else if (other < blob) {
+                    fimd_cpu_blob_merge(columns, blobs, other - 1, blob - 1);
+                    blob = other;
+                    (*blobs_merged)++;
+                } else {
+                    fimd_cpu_blob_merge(columns, blobs, blob - 1, other - 1);
+                    (*blobs_merged)++;
+                }
+            }
+        }
+
+        fimd_cpu_sun_blob_t* b;
+        if (blob == 0) {
+            if (*blobs_num >= blobs_max && *blobs_merged > 0) {
+                fimd_cpu_blobs_compact(columns, blobs, blobs_num);
+                *blobs_merged = 0;
+            }
+            if (*blobs_num >= blobs_max) {
+                continue; // no space for a new blob
+            }
+            blob = ++(*blobs_num);
+            b = &blobs[blob - 1];
+            b->x_min = b->x_max = (uint16_t) x;
+            b->y_min = b->y_max = (uint16_t) y;
+            b->count = 1;
+            b->x_sum = x;
+            b->y_sum = y;
+        } else {
+            b = &blobs[blob - 1];
+            b->count++;
+            b->x_sum += x;
+            b->y_sum += y;
+            if (x < b->x_min) b->x_min = (uint16_t) x;
+            if (x > b->x_max) b->x_max = (uint16_t) x;
+            b->y_max = (uint16_t) y;
+        }
+        columns[x].row = y;
+        columns[x].blob = blob;
+        columns_set[x >> 6] |= 1ULL << (x & 63);
+    }
+}
+
+int fimd_cpu_ctx_detect_blobs(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, fimd_cpu_sun_blob_t blobs[], unsigned blobs_max, unsigned* blobs_num)
+{
+    *markers_num = 0;
+    *blobs_num = 0;
+
+    fimd_scan_kernel_t kernel = fimd_cpu_get_bounded_kernel(ctx, radius);
+    if (!kernel) {
+        return -2; // Invalid radius
+    }
+
+    // the sun points of each chunk are aggregated, then the scan continues from the central pixel where it stopped
+    // (the suppressed pixels and the markers are kept in the scan state)
+    fimd_cpu_point_t chunk[FIMD_BLOB_CHUNK_COUNT];
+    unsigned blobs_merged = 0;
+    memset(ctx->sun_columns_set, 0, FIMD_SUN_COLUMNS_WORDS(ctx->resolution.stride) * sizeof(uint64_t));
+    fimd_scan_t scan;
+    fimd_cpu_scan_init(ctx, &scan, img_ptr);
+    scan.begin = img_ptr + FIMD_OFFSET(ctx->resolution.stride, radius);
+    scan.end = img_ptr + ctx->image_size - 1 - FIMD_OFFSET(ctx->resolution.stride, radius);
+    scan.sun_pts = chunk;
+    scan.sun_pts_max = FIMD_BLOB_CHUNK_COUNT;
+    while (1) {
+        const uint8_t* stop_ptr = kernel(&scan);
+        fimd_cpu_blobs_add(ctx->sun_columns, ctx->sun_columns_set, ctx->resolution.width, blobs, blobs_num, &blobs_merged, blobs_max, chunk, scan.sun_pts_num, 2*radius);
+        if (stop_ptr == scan.end || scan.markers_num >= scan.markers_max) {
+            break;
+        }
+        scan.begin = stop_ptr;
+        scan.sun_pts_num = 0;
+    }
+    fimd_cpu_scan_release(ctx, &scan);
+
+    // drop the blobs merged into the older ones, the centroids are divided once
+    fimd_cpu_blobs_compact(ctx->sun_columns, blobs, blobs_num);
+    for (unsigned i = 0; i < *blobs_num; i++) {
+        blobs[i].x = (float) ((double) blobs[i].x_sum / blobs[i].count);
+        blobs[i].y = (float) ((double) blobs[i].y_sum / blobs[i].count);
+    }
+
+    *markers_num = scan.markers_num;
+    fimd_cpu_points_to_coords(ctx->markers_xy, *markers_num, markers);
+
+    return 0;
+}
+
+// Number of the regions of interest clamped on the stack (more regions are clamped into a heap buffer)
+#define FIMD_ROI_STACK_COUNT 64
+
+// Range of the central pixels of a region of interest [x0, x1) x [y0, y1)
+struct fimd_cpu_roi_range_s {
+    unsigned x0;
+    unsigned y0;
+    unsigned x1;
+    unsigned y1;
+};
+
+// clamps the regions of interest to the central pixels with the whole circle inside the image and sorts them
+// by the first column (insertion sort, there are only a few regions), returns the number of non-empty ranges
+static unsigned fimd_cpu_roi_ranges(const struct fimd_cpu_resolution_s* res, unsigned radius, const fimd_cpu_roi_t rois[], unsigned rois_count, struct fimd_cpu_roi_range_s* ranges)
+{
+    unsigned ranges_count = 0;
+    for (unsigned i = 0; i < rois_count; i++) {
+        struct fimd_cpu_roi_range_s range;
+        if (rois[i].x >= res->width - radius || rois[i].y >= res->height - radius) {
+            continue;
+        }
+        range.x0 = (rois[i].x > radius) ? rois[i].x : radius;
+        range.y0 = (rois[i].y > radius) ? rois[i].y : radius;
+        range.x1 = (rois[i].width < res->width - radius - rois[i].x) ? rois[i].x + rois[i].width : res->width - radius;
+        range.y1 = (rois[i].height < res->height - radius - rois[i].y) ? rois[i].y + rois[i].height : res->height - radius;
+        if (range.x0 >= range.x1 || range.y0 >= range.y1) {
+            continue;
+        }
+        unsigned j = ranges_count++;
+        for (; j > 0 && ranges[j-1].x0 > range.x0; j--) {
+            ranges[j] = ranges[j-1];
+        }
+        ranges[j] = range;
+    }
+    return ranges_count;
+}
+
+int fimd_cpu_ctx_detect_roi(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, const fimd_cpu_roi_t rois[], unsigned rois_count, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num)
+{
+    *markers_num = 0;
+    *sun_pts_num = 0;
+
+    fimd_scan_kernel_t kernel = fimd_cpu_get_bounded_kernel(ctx, radius);
+    if (!kernel || 2*radius >= ctx->resolution.width || 2*radius >= ctx->resolution.height) {
+        return -2; // Invalid radius
+    }
+
+    // clamped regions followed by the merged column ranges of the current band of rows
+    struct fimd_cpu_roi_range_s ranges_stack[2 * FIMD_ROI_STACK_COUNT];
+    struct fimd_cpu_roi_range_s* ranges = ranges_stack;
+    if (rois_count > FIMD_ROI_STACK_COUNT) {
+        ranges = (struct fimd_cpu_roi_range_s*) malloc(2 * (size_t) rois_count * sizeof(struct fimd_cpu_roi_range_s));
+        if (!ranges) {
+            return -1; // Memory allocation error
+        }
+    }
+    unsigned ranges_count = fimd_cpu_roi_ranges(&ctx->resolution, radius, rois, rois_count, ranges);
+    struct fimd_cpu_roi_range_s* merged = ranges + ranges_count;
+    unsigned row = ctx->resolution.height;
+    for (unsigned i = 0; i < ranges_count; i++) {
+        row = (ranges[i].y0 < row) ? ranges[i].y0 : row;
+    }
+
+    // the same scan state for all ranges, hence the suppressed pixels and the limits are shared by the regions
+    fimd_scan_t scan;
+    fimd_cpu_scan_init(ctx, &scan, img_ptr);
+    int stopped = 0;
+    while (!stopped) {
+        // band of rows [row, band_end) covered by the same regions, their column ranges are merged in the ascending order
+        unsigned band_end = ctx->resolution.height;
+        unsigned merged_count = 0;
+        for (unsigned i = 0; i < ranges_count; i++) {
+            if (row < ranges[i].y0) {
+                band_end = (ranges[i].y0 < band_end) ? ranges[i].y0 : band_end;
+                continue;
+            }
+            if (row >= ranges[i].y1) {
+                continue;
+            }
+            band_end = (ranges[i].y1 < band_end) ? ranges[i].y1 : band_end;
+            if (merged_count > 0 && ranges[i].x0 <= merged[merged_count-1].x1) {
+                merged[merged_count-1].x1 = (ranges[i].x1 > merged[merged_count-1].x1) ? ranges[i].x1 : merged[merged_count-1].x1;
+            } else {
+                merged[merged_count++] = ranges[i];
+            }
+        }
+        if (row >= band_end) {
+            break; // no region below
+        }
+
+        for (; row < band_end && !stopped; row++) {
+            const uint8_t* row_ptr = img_ptr + (uintptr_t) row * ctx->resolution.stride;
+            for (unsigned i = 0; i < merged_count && !stopped; i++) {
+                scan.begin = row_ptr + merged[i].x0;
+                scan.end = row_ptr + merged[i].x1;
+                stopped = kernel(&scan) != scan.end; // limit reached
+            }
+        }
+    }
+    fimd_cpu_scan_release(ctx, &scan);
+    if (ranges != ranges_stack) {
+        free(ranges);
+    }
+
+    *markers_num = scan.markers_num;
+    *sun_pts_num = scan.sun_pts_num;
+    fimd_cpu_points_to_coords(ctx->markers_xy, *markers_num, markers);
+    fimd_cpu_points_to_coords(ctx->sun_pts_xy, *sun_pts_num, sun_pts);
+
+    return 0;
+}
+
+// Pixels per chunk of the rows unpacked from the packed frames (a multiple of it for the rows above 64 chunks),
+// a chunk holds whole cycles of the groups and the vector blocks (RAW10: 5 blocks, RAW12: 3 blocks per cycle)
+#if FIMD_SIMD_WIDTH
+#define FIMD_PACKED_CHUNK (4 * FIMD_SIMD_WIDTH)
+#else
+#define FIMD_PACKED_CHUNK 64
+#endif
+
+// Layout of the packed frame (the groups have group_pixels high bytes followed by the byte with the low bits)
+struct fimd_cpu_packing_s {
+    const uint8_t* packed_ptr;
+    unsigned packed_stride;
+    unsigned row_bytes;
+    unsigned chunk_pixels;
+    unsigned chunk_bytes;
+#if FIMD_SIMD_WIDTH
+    // high bytes of the blocks starting at each byte of a group (the bytes with the low bits are cleared),
+    // followed by a block of zeros
+    uint8_t high_bytes[6][FIMD_SIMD_WIDTH];
+#endif
+};
+
+// returns the chunks of a packed row with a high byte above the threshold (inlined with the constant layout,
+// so that no division remains)
+static inline uint64_t fimd_cpu_packed_row_centers(const struct fimd_cpu_packing_s* packing, uint32_t row, const unsigned group_pixels, const unsigned group_bytes)
+{
+    const uint8_t threshold_center = fimd_cpu_thresholds.center;
+    const uint8_t* row_ptr = packing->packed_ptr + (uintptr_t) row * packing->packed_stride;
+    uint64_t centers = 0;
+
+#if FIMD_SIMD_WIDTH
+    fimd_simd_vec_t high_cycle[5];
+    for (unsigned block = 0; block < group_bytes; block++) {
+        high_cycle[block] = fimd_simd_load(packing->high_bytes[block * FIMD_SIMD_WIDTH % group_bytes]);
+    }
+#endif
+
+    for (unsigned chunk = 0, pos = 0; pos < packing->row_bytes; chunk++) {
+        unsigned chunk_end = (pos + packing->chunk_bytes < packing->row_bytes) ? pos + packing->chunk_bytes : packing->row_bytes;
+        int above = 0;
+#if FIMD_SIMD_WIDTH
+        // maximum of the high bytes of the blocks (whole cycles, then single blocks), compared once per chunk
+        fimd_simd_vec_t high_max = fimd_simd_load(packing->high_bytes[5]);
+        for (; pos + group_bytes * FIMD_SIMD_WIDTH <= chunk_end; pos += group_bytes * FIMD_SIMD_WIDTH) {
+            for (unsigned block = 0; block < group_bytes; block++) {
+                high_max = fimd_simd_max(high_max, fimd_simd_and(fimd_simd_load(row_ptr + pos + block * FIMD_SIMD_WIDTH), high_cycle[block]));
+            }
+        }
+        for (; pos + FIMD_SIMD_WIDTH <= chunk_end; pos += FIMD_SIMD_WIDTH) {
+            high_max = fimd_simd_max(high_max, fimd_simd_and(fimd_simd_load(row_ptr + pos), fimd_simd_load(packing->high_bytes[pos % group_bytes])));
+        }
+        above = fimd_simd_gt_mask(high_max, threshold_center) != 0;
+#endif
+        // remaining bytes of the chunk (the low bits are skipped)
+        for (; pos < chunk_end; pos++) {
+            above |= pos % group_bytes != group_pixels && row_ptr[pos] > threshold_center;
+        }
+        centers |= (uint64_t) above << chunk;
+    }
+    return centers;
+}
+
+// copies the high bytes of the chunks of a packed row into the row of the scratch frame (inlined with the constant layout)
+static inline void fimd_cpu_packed_row_unpack(const struct fimd_cpu_packing_s* packing, uint32_t row, uint64_t chunks, uint8_t* dst_row, uint32_t width, const unsigned group_pixels, const unsigned group_bytes)
+{
+    for (; chunks; chunks &= chunks - 1) {
+        unsigned chunk_first = (unsigned) __builtin_ctzll(chunks) * packing->chunk_pixels;
+        unsigned groups = ((chunk_first + packing->chunk_pixels < width) ? packing->chunk_pixels : width - chunk_first) / group_pixels;
+        const uint8_t* src = packing->packed_ptr + (uintptr_t) row * packing->packed_stride + chunk_first / group_pixels * group_bytes;
+        uint8_t* dst = dst_row + chunk_first;
+        for (unsigned g = 0; g < groups; g++) {
+            memcpy(dst, src, group_pixels);
+            dst += group_pixels;
+            src += group_bytes;
+        }
+    }
+}
+
+int fimd_cpu_ctx_detect_packed(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* packed_ptr, unsigned bits, unsigned packed_stride, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num)
+{
+    *markers_num = 0;
+    *sun_pts_num = 0;
+
+    // RAW10: 4 pixels in 5 bytes, RAW12: 2 pixels in 3 bytes
+    unsigned group_pixels = (bits == 10) ? 4 : 2;
+    unsigned group_bytes = (bits == 10) ? 5 : 3;
+    uint32_t width = ctx->resolution.width;
+    uint32_t height = ctx->resolution.height;
+    uint32_t stride = ctx->resolution.stride;
+    if (packed_stride == 0) {
+        packed_stride = width / group_pixels * group_bytes;
+    }
+    fimd_scan_kernel_t kernel = fimd_cpu_get_bounded_kernel(ctx, radius);
+    if (!kernel || 2*radius >= width || 2*radius >= height) {
+        return -2; // Invalid radius
+    }
+    if ((bits != 10 && bits != 12) || width % group_pixels != 0 || packed_stride < width / group_pixels * group_bytes) {
+        return -2; // Invalid packing
+    }
+
+    if (!ctx->packed_centers) {
+        ctx->packed_centers = (uint64_t*) calloc(height, sizeof(uint64_t));
+        ctx->packed_unpack = (uint64_t*) calloc(height, sizeof(uint64_t));
+        if (!ctx->packed_centers || !ctx->packed_unpack) {
+            free(ctx->packed_centers);
+            free(ctx->packed_unpack);
+            ctx->packed_centers = NULL;
+            ctx->packed_unpack = NULL;
+            return -1; // Memory allocation error
+        }
+    }
+
+    // at most 64 chunks per row
+    struct fimd_cpu_packing_s packing;
+    packing.packed_ptr = packed_ptr;
+    packing.packed_stride = packed_stride;
+    packing.row_bytes = width / group_pixels * group_bytes;
+    packing.chunk_pixels = FIMD_PACKED_CHUNK * ((width + 64 * FIMD_PACKED_CHUNK - 1) / (64 * FIMD_PACKED_CHUNK));
+    packing.chunk_bytes = packing.chunk_pixels / group_pixels * group_bytes;
+#if FIMD_SIMD_WIDTH
+    memset(packing.high_bytes, 0, sizeof(packing.high_bytes));
+    for (unsigned phase = 0; phase < group_bytes; phase++) {
+        for (unsigned i = 0; i < FIMD_SIMD_WIDTH; i++) {
+            packing.high_bytes[phase][i] = ((phase + i) % group_bytes != group_pixels) ? 0xFF : 0x00;
+        }
+    }
+#endif
+    unsigned chunks_count = (width + packing.chunk_pixels - 1) / packing.chunk_pixels;
+    uint64_t chunks_all = (chunks_count < 64) ? ((uint64_t) 1 << chunks_count) - 1 : ~((uint64_t) 0);
+    uint64_t chunks_edges = ((uint64_t) 1 << (chunks_count - 1)) | 1;
+    unsigned chunks_radius = (radius + packing.chunk_pixels - 1) / packing.chunk_pixels;
+    memset(ctx->packed_unpack, 0, height * sizeof(uint64_t));
+
+    // the same range of the central pixels as for the whole frame with the same suppressed pixels and limits
+    uintptr_t first = FIMD_OFFSET(stride, radius);
+    uintptr_t last = ctx->image_size - 1 - FIMD_OFFSET(stride, radius);
+    fimd_scan_t scan;
+    fimd_cpu_scan_init(ctx, &scan, ctx->frame);
+
+    // single pass over the rows while the packed rows are still in the cache: the chunks with a high byte above
+    // the threshold are found in the row y, the row y - radius - 1 is unpacked (no later row reads it), and the central
+    // pixels of the row y - 2*radius - 2 are tested (all rows read by them are unpacked)
+    int stopped = 0;
+    for (uint32_t row = radius; row < height + radius + 2 && !stopped; row++) {
+        if (row < height - radius) {
+            // chunks read by the tests of the central pixels (the neighbouring chunks in the rows within the radius),
+            // the circles of the central pixels in the first and the last chunk of a row may wrap around
+            // to the neighbouring rows, which are then unpacked whole
+            uint64_t centers = (bits == 10) ? fimd_cpu_packed_row_centers(&packing, row, 4, 5) : fimd_cpu_packed_row_centers(&packing, row, 2, 3);
+            ctx->packed_centers[row] = centers;
+            if (centers) {
+                uint64_t chunks = centers;
+                for (unsigned i = 1; i <= chunks_radius; i++) {
+                    chunks |= (centers << i) | (centers >> i);
+                }
+                uint32_t row_first = row - radius;
+                uint32_t row_last = row + radius;
+                if (centers & chunks_edges) {
+                    chunks = chunks_all;
+                    row_first = (row_first > 0) ? row_first - 1 : 0;
+                    row_last = (row_last < height - 1) ? row_last + 1 : height - 1;
+                }
+                for (uint32_t r = row_first; r <= row_last; r++) {
+                    ctx->packed_unpack[r] |= chunks & chunks_all;
+                }
+            }
+        }
+
+        uint32_t unpack_row = row - radius - 1;
+        if (row >= radius + 1 && unpack_row < height && ctx->packed_unpack[unpack_row]) {
+            uint8_t* dst_row = ctx->frame + (uintptr_t) unpack_row * stride;
+            if (bits == 10) {
+                fimd_cpu_packed_row_unpack(&packing, unpack_row, ctx->packed_unpack[unpack_row], dst_row, width, 4, 5);
+            } else {
+                fimd_cpu_packed_row_unpack(&packing, unpack_row, ctx->packed_unpack[unpack_row], dst_row, width, 2, 3);
+            }
+        }
+
+        uint32_t center_row = row - 2*radius - 2;
+        if (row < 3*radius + 2 || center_row >= height - radius) {
+            continue;
+        }
+        // the runs of the consecutive chunks (the pixels not above the threshold are skipped by the kernel)
+        for (uint64_t centers = ctx->packed_centers[center_row]; centers && !stopped; ) {
+            unsigned chunk = (unsigned) __builtin_ctzll(centers);
+            // the run reaches the last chunk if all bits from the first one are set (ctz of 0 is undefined)
+            uint64_t run_end = ~(centers >> chunk);
+            unsigned chunk_end = (run_end == 0) ? 64 : chunk + (unsigned) __builtin_ctzll(run_end);
+            centers &= (chunk_end < 64) ? ~((uint64_t) 0) << chunk_end : 0;
+            uintptr_t begin = (uintptr_t) center_row * stride + chunk * packing.chunk_pixels;
+            uintptr_t end = (uintptr_t) center_row * stride + ((chunk_end * packing.chunk_pixels < width) ? chunk_end * packing.chunk_pixels : width);
+            begin = (begin > first) ? begin : first;
+            end = (end < last) ? end : last;
+            if (begin < end) {
+                scan.begin = ctx->frame + begin;
+                scan.end = ctx->frame + end;
+                stopped = kernel(&scan) != scan.end; // limit reached
+            }
+        }
+    }
+    fimd_cpu_scan_release(ctx, &scan);
+
+    *markers_num = scan.markers_num;
+    *sun_pts_num = scan.sun_pts_num;
+    fimd_cpu_points_to_coords(ctx->markers_xy, *markers_num, markers);
+    fimd_cpu_points_to_coords(ctx->sun_pts_xy, *sun_pts_num, sun_pts);
+
+    return 0;
+}
+
+int fimd_cpu_ctx_detect_fused(fimd_cpu_ctx_t* ctx, const unsigned char* img_ptr, unsigned markers[][3], unsigned* markers_num, unsigned sun_pts[][3], unsigned* sun_pts_num)
+{
+    *markers_num = 0;
+    *sun_pts_num = 0;
+
+    const fimd_kernel_set_t* set = fimd_cpu_get_kernel_set(ctx);
+    if (!set) {
+        return -2; // No fused kernel for the row pitch
+    }
+
+    // append termination sequence to image end
+    fimd_cpu_copy_pixels(&ctx->resolution, ctx->frame, img_ptr, 0, ctx->image_size);
+    fimd_cpu_zero_defects(ctx, ctx->frame, 0, ctx->image_size);
+    *((uint16_t*) (ctx->frame + ctx->image_size - 2)) = FIMD_TERM_SEQ;
+    set->fused(ctx->frame, ctx->frame + ctx->image_size, ctx->markers_ptrs, ctx->markers_radii, markers_num, ctx->sun_pts_ptrs, ctx->sun_pts_radii, sun_pts_num);
+
+    uint32_t stride = ctx->resolution.stride;
+    uintptr_t pos1d;
+    for (unsigned i = 0; i < *markers_num; i++) {
+        pos1d = ctx->markers_ptrs[i] - ((uintptr_t) ctx->frame);
+        markers[i][2] = ctx->markers_radii[i];
+        markers[i][1] = pos1d / stride;
+        markers[i][0] = pos1d % stride;
+    }
+
+    for (unsigned i = 0; i < *sun_pts_num; i++) {
+        pos1d = ctx->sun_pts_ptrs[i] - ((uintptr_t) ctx->frame);
+        sun_pts[i][2] = ctx->sun_pts_radii[i];
+        sun_pts[i][1] = pos1d / stride;
+        sun_pts[i][0] = pos1d % stride;
+    }
+
+    return 0;
+}
+
+static void fimd_cpu_ctx_release_stripes(fimd_cpu_ctx_t* ctx)
+{
+    fimd_pool_destroy(ctx->pool);
+    ctx->pool = NULL;
+
+    if (ctx->stripes) {
+        for (unsigned i = 0; i < ctx->stripes_count; i++) {
+            free(ctx->stripes[i].buffer);
+            free(ctx->stripes[i].suppressed);
+        }
+        free(ctx->stripes);
+    }
+    ctx->stripes = NULL;
+    ctx->stripes_count = 0;
+    ctx->stripes_radius = 0;
+}
+
+int fimd_cpu_ctx_set_threads_count(fimd_cpu_ctx_t* ctx, unsigned threads_count)
+{
+    fimd_cpu_ctx_release_stripes(ctx);
+    if (threads_count <= 1) {
+        return 0;
+    }
+
+    unsigned radius_max = 0;
+    for (unsigned i = 0; i < FIMD_RADII_COUNT; i++) {
+        if (fimd_radii_list[i] > radius_max) {
+            radius_max = fimd_radii_list[i];
+        }
+    }
+
+    // the largest stripe including the halo rows above and below
+    size_t stripe_rows = (ctx->resolution.height + threads_count - 1) / threads_count;
+    size_t buffer_size = (stripe_rows + 2*radius_max + 1) * ctx->resolution.stride + 2*radius_max + 1;
+
+    ctx->stripes = (struct fimd_cpu_stripe_s*) malloc(threads_count * sizeof(struct fimd_cpu_stripe_s));
+    if (!ctx->stripes) {
+        return -1; // Memory allocation error
+    }
+
+    for (unsigned i = 0; i < threads_count; i++) {
+        memset(&ctx->stripes[i], 0, sizeof(struct fimd_cpu_stripe_s));
+        if (posix_memalign((void**) &ctx->stripes[i].buffer, FIMD_FRAME_ALIGNMENT, buffer_size) != 0) {
+            ctx->stripes[i].buffer = NULL;
+            ctx->stripes_count = i + 1;
+            fimd_cpu_ctx_release_stripes(ctx);
+            return -1; // Memory allocation error
+        }
+        memset(ctx->stripes[i].buffer, 0, buffer_size);
+
+        ctx->stripes[i].suppressed = (uint8_t*) calloc(FIMD_SCAN_BITMAP_SIZE(ctx->image_size) + FIMD_SCAN_BITMAP_PADDING, sizeof(uint8_t));
+        if (!ctx->stripes[i].suppressed) {
+            ctx->stripes_count = i + 1;
+            fimd_cpu_ctx_release_stripes(ctx);
+            return -1; // Memory allocation error
+        }
+        fimd_cpu_suppress_padding(&ctx->resolution, ctx->stripes[i].suppressed, 0, ctx->image_size);
+        fimd_cpu_suppress_defects(ctx, ctx->stripes[i].suppressed, 0, ctx->image_size);
+    }
+    ctx->stripes_count = threads_count;
+    ctx->stripes_radius = radius_max;
+
+    ctx->pool = fimd_pool_create(threads_count);
+    if (!ctx->pool) {
+        fimd_cpu_ctx_release_stripes(ctx);
+        return -1; // Thread creation error
+    }
+
+    return 0;
+}
+
+unsigned fimd_cpu_ctx_get_threads_count(const fimd_cpu_ctx_t* ctx)
+{
+    return (ctx->pool) ? fimd_pool_threads_count(ctx->pool) : 1;
+}
+
+static uint8_t* fimd_cpu_stripe_run(const fimd_cpu_ctx_t* ctx, struct fimd_cpu_stripe_s* stripe, fimd_kernel_t kernel, uintptr_t offset, const uint8_t* img_ptr, const uint8_t* overlay, uintptr_t* markers, uint32_t* markers_num, uintptr_t* sun_pts, uint32_t* sun_pts_num)
+{
+    // copy the stripe with halo rows, the termination sequence is placed right after the last central pixel of the stripe
+    uintptr_t size = (stripe->end - stripe->begin) + 2*offset + 1;
+    fimd_cpu_copy_pixels(&ctx->resolution, stripe->buffer, img_ptr, stripe->begin - offset, size);
+    fimd_cpu_zero_defects(ctx, stripe->buffer, stripe->begin - offset, size);
+    if (overlay) {
+        memcpy(stripe->buffer, overlay, 2*offset - 1);
+    }
+    *((uint16_t*) (stripe->buffer + size - 2)) = FIMD_TERM_SEQ;
+
+    return kernel(stripe->buffer, stripe->buffer + size, markers, markers_num, sun_pts, sun_pts_num);
+}
+
+static void fimd_cpu_stripe_task(void* arg, unsigned task_index, unsigned worker_index)
+{
+    fimd_cpu_ctx_t* ctx = (fimd_cpu_ctx_t*) arg;
+    struct fimd_cpu_stripe_s* stripe = &ctx->stripes[task_index];
+    (void) worker_index;
+
+    stripe->markers_num = 0;
+    stripe->sun_pts_num = 0;
+    stripe->stop_ptr = fimd_cpu_stripe_run(ctx, stripe, ctx->job_kernel, ctx->job_offset, ctx->job_img_ptr, NULL, stripe->markers_ptrs, &stripe->markers_num, stripe->sun_pts_ptrs, &stripe->sun_pts_num);
+}
+
+int fimd_cpu_ctx_detect_parallel(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num)
+{
+    // the halo rows of the stripes fit the generated radii only (larger emitted radii are detected serially)
+    if (!ctx->pool || radius > ctx->stripes_radius) {
+        return fimd_cpu_ctx_detect(ctx, radius, img_ptr, markers, markers_num, sun_pts, sun_pts_num);
+    }
+
+    *markers_num = 0;
+    *sun_pts_num = 0;
+
+    fimd_kernel_t kernel = fimd_cpu_get_kernel(ctx, radius);
+    if (!kernel) {
+        return -2; // Invalid radius
+    }
+
+    // split rows of the central pixels into stripes (the first and the last one follow the serial scan range)
+    uint32_t stride = ctx->resolution.stride;
+    uintptr_t offset = FIMD_OFFSET(stride, radius);
+    unsigned rows = ctx->resolution.height - 2*radius;
+    unsigned stripes_count = (ctx->stripes_count < rows) ? ctx->stripes_count : rows;
+    for (unsigned i = 0; i < stripes_count; i++) {
+        ctx->stripes[i].begin = (i == 0) ? offset : (radius + (i * rows) / stripes_count) * stride;
+        ctx->stripes[i].end = (i == stripes_count - 1) ? (ctx->image_size - 1 - offset) : (radius + ((i + 1) * rows) / stripes_count) * stride;
+    }
+
+    // speculative detection of all stripes in parallel, each on its own copy of the original image
+    ctx->job_kernel = kernel;
+    ctx->job_offset = offset;
+    ctx->job_img_ptr = img_ptr;
+    fimd_pool_run(ctx->pool, fimd_cpu_stripe_task, ctx, stripes_count);
+
+    // merge the stripes in order, the result of a stripe is valid only if the serial scan would reach it in the same state
+    uint32_t total_markers_num = 0;
+    uint32_t total_sun_pts_num = 0;
+    for (unsigned i = 0; i < stripes_count; i++) {
+        struct fimd_cpu_stripe_s* stripe = &ctx->stripes[i];
+        const uint8_t* overlay = NULL;
+        int rerun = 0;
+
+        // interior pixels zeroed by the previous stripe, which reach into the halo rows of this stripe
+        if (i > 0) {
+            const uint8_t* prev_overlap = ctx->stripes[i-1].buffer + (stripe->begin - ctx->stripes[i-1].begin);
+            if (fimd_cpu_halo_differs(ctx, prev_overlap, img_ptr, stripe->begin - offset, 2*offset - 1)) {
+                overlay = prev_overlap;
+                rerun = 1;
+            }
+        }
+
+        // limits on the number of detections depend on the detections in the previous stripes
+        if ((total_markers_num + stripe->markers_num >= FIMD_MAX_MARKERS_COUNT) || (total_sun_pts_num + stripe->sun_pts_num >= FIMD_MAX_SUN_PTS_COUNT)) {
+            rerun = 1;
+        }
+
+        uintptr_t base = ((uintptr_t) stripe->buffer) - (stripe->begin - offset);
+        if (rerun) {
+            // repeat the detection of this stripe serially, appending directly to the merged results
+            uint32_t first_marker = total_markers_num;
+            uint32_t first_sun_pt = total_sun_pts_num;
+            stripe->stop_ptr = fimd_cpu_stripe_run(ctx, stripe, kernel, offset, img_ptr, overlay, ctx->markers_ptrs, &total_markers_num, ctx->sun_pts_ptrs, &total_sun_pts_num);
+            for (uint32_t j = first_marker; j < total_markers_num; j++) {
+                ctx->markers_ptrs[j] -= base;
+            }
+            for (uint32_t j = first_sun_pt; j < total_sun_pts_num; j++) {
+                ctx->sun_pts_ptrs[j] -= base;
+            }
+        } else {
+            for (uint32_t j = 0; j < stripe->markers_num; j++) {
+                ctx->markers_ptrs[total_markers_num++] = stripe->markers_ptrs[j] - base;
+            }
+            for (uint32_t j = 0; j < stripe->sun_pts_num; j++) {
+                ctx->sun_pts_ptrs[total_sun_pts_num++] = stripe->sun_pts_ptrs[j] - base;
+            }
+        }
+
+        // early termination (limits reached or termination sequence found in the image data) skips the remaining stripes
+        if (stripe->stop_ptr != stripe->buffer + (stripe->end - stripe->begin) + offset - 1) {
+            break;
+        }
+    }
+
+    *markers_num = total_markers_num;
+    *sun_pts_num = total_sun_pts_num;
+    fimd_cpu_release_kernel(ctx, radius, kernel);
+    fimd_cpu_ptrs_to_coords(ctx->markers_ptrs, *markers_num, 0, stride, markers);
+    fimd_cpu_ptrs_to_coords(ctx->sun_pts_ptrs, *sun_pts_num, 0, stride, sun_pts);
+
+    return 0;
+}
+
+static void fimd_cpu_radius_task(void* arg, unsigned task_index, unsigned worker_index)
+{
+    fimd_cpu_ctx_t* ctx = (fimd_cpu_ctx_t*) arg;
+
+    // all radii read the same image, each worker suppresses the interior pixels in its own bitmap
+    fimd_cpu_scan_points(ctx, ctx->job_radii[task_index], ctx->job_img_ptr, ctx->stripes[worker_index].suppressed, 0, &ctx->job_markers[task_index], &ctx->job_sun_pts[task_index]);
+}
+
+int fimd_cpu_ctx_detect_radii(fimd_cpu_ctx_t* ctx, const unsigned radii[], unsigned radii_count, const unsigned char* img_ptr, fimd_cpu_points_t markers[], fimd_cpu_points_t sun_pts[])
+{
+    for (unsigned i = 0; i < radii_count; i++) {
+        if (!fimd_cpu_get_bounded_kernel(ctx, radii[i])) {
+            return -2; // Invalid radius
+        }
+    }
+
+    if (!ctx->pool) {
+        for (unsigned i = 0; i < radii_count; i++) {
+            fimd_cpu_scan_points(ctx, radii[i], img_ptr, ctx->suppressed, 0, &markers[i], &sun_pts[i]);
+        }
+        return 0;
+    }
+
+    ctx->job_img_ptr = img_ptr;
+    ctx->job_radii = radii;
+    ctx->job_markers = markers;
+    ctx->job_sun_pts = sun_pts;
+    fimd_pool_run(ctx->pool, fimd_cpu_radius_task, ctx, radii_count);
+
+    return 0;
+}
+
+void fimd_cpu_ctx_destroy(fimd_cpu_ctx_t* ctx)
+{
+    if (!ctx) {
+        return;
+    }
+    fimd_cpu_ctx_release_stripes(ctx);
+    free(ctx->defects);
+    free(ctx->sun_mask);
+    free(ctx->sun_columns_set);
+    free(ctx->sun_columns);
+    free(ctx->suppressed);
+    free(ctx->frame);
+    free(ctx->frame16);
+    free(ctx->packed_centers);
+    free(ctx->packed_unpack);
+    free(ctx);
+}
+
+fimd_cpu_batch_t* fimd_cpu_batch_create(unsigned width, unsigned height, unsigned stride, unsigned threads_count)
+{
+    if (threads_count == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads_count = (online > 0) ? (unsigned) online : 1;
+    }
+
+    fimd_cpu_batch_t* batch = (fimd_cpu_batch_t*) calloc(1, sizeof(struct fimd_cpu_batch_s));
+    if (!batch) {
+        return NULL;
+    }
+    if (pthread_mutex_init(&batch->lock, NULL) != 0) {
+        free(batch);
+        return NULL;
+    }
+
+    batch->contexts = (fimd_cpu_ctx_t**) calloc(threads_count, sizeof(fimd_cpu_ctx_t*));
+    if (!batch->contexts) {
+        fimd_cpu_batch_destroy(batch);
+        return NULL;
+    }
+    for (unsigned i = 0; i < threads_count; i++) {
+        batch->contexts[i] = fimd_cpu_ctx_create_resolution(width, height, stride);
+        batch->contexts_count = i + 1;
+        if (!batch->contexts[i]) {
+            fimd_cpu_batch_destroy(batch);
+            return NULL; // Resolution not supported or memory allocation error
+        }
+    }
+
+    batch->pool = fimd_pool_create(threads_count);
+    if (!batch->pool) {
+        fimd_cpu_batch_destroy(batch);
+        return NULL; // Thread creation error
+    }
+
+    return batch;
+}
+
+unsigned fimd_cpu_batch_get_threads_count(const fimd_cpu_batch_t* batch)
+{
+    return fimd_pool_threads_count(batch->pool);
+}
+
+// reserves up to count points at the end of the arena buffer, returns the number of reserved points (lock held)
+static unsigned fimd_cpu_batch_reserve(fimd_cpu_points_t* points, unsigned count, unsigned* offset)
+{
+    unsigned reserved = fimd_cpu_points_free(points, count);
+    *offset = points->count;
+    points->count += reserved;
+    return reserved;
+}
+
+static void fimd_cpu_batch_task(void* arg, unsigned task_index, unsigned worker_index)
+{
+    fimd_cpu_batch_t* batch = (fimd_cpu_batch_t*) arg;
+    fimd_cpu_ctx_t* ctx = batch->contexts[worker_index];
+    fimd_cpu_batch_results_t* results = batch->job_results;
+
+    for (unsigned i = 0; i < batch->job_radii_count; i++) {
+        fimd_cpu_batch_entry_t* entry = &results->entries[(size_t) task_index * batch->job_radii_count + i];
+        fimd_kernel_t kernel = fimd_cpu_get_kernel(ctx, batch->job_radii[i]);
+        uint32_t markers_num = 0;
+        uint32_t sun_pts_num = 0;
+
+        fimd_cpu_copy_pixels(&ctx->resolution, ctx->frame, batch->job_frames[task_index], 0, ctx->image_size);
+        *((uint16_t*) (ctx->frame + ctx->image_size - 2)) = FIMD_TERM_SEQ;
+        kernel(ctx->frame, ctx->frame + ctx->image_size, ctx->markers_ptrs, &markers_num, ctx->sun_pts_ptrs, &sun_pts_num);
+        fimd_cpu_release_kernel(ctx, batch->job_radii[i], kernel);
+
+        // only the reservation is serialized, the points are converted straight into the arena
+        pthread_mutex_lock(&batch->lock);
+        entry->markers_count = fimd_cpu_batch_reserve(&results->markers, markers_num, &entry->markers_offset);
+        entry->sun_pts_count = fimd_cpu_batch_reserve(&results->sun_pts, sun_pts_num, &entry->sun_pts_offset);
+        if (entry->markers_count < markers_num || entry->sun_pts_count < sun_pts_num) {
+            batch->job_overflow = 1;
+        }
+        pthread_mutex_unlock(&batch->lock);
+
+        fimd_cpu_ptrs_to_points(ctx->markers_ptrs, entry->markers_count, (uintptr_t) ctx->frame, ctx->resolution.stride, results->markers.data + entry->markers_offset);
+        fimd_cpu_ptrs_to_points(ctx->sun_pts_ptrs, entry->sun_pts_count, (uintptr_t) ctx->frame, ctx->resolution.stride, results->sun_pts.data + entry->sun_pts_offset);
+    }
+}
+
+int fimd_cpu_batch_detect(fimd_cpu_batch_t* batch, const unsigned char* const frames[], unsigned frames_count, const unsigned radii[], unsigned radii_count, fimd_cpu_batch_results_t* results)
+{
+    // all kernels are looked up (or emitted) before any frame is processed
+    for (unsigned i = 0; i < radii_count; i++) {
+        fimd_kernel_t kernel = fimd_cpu_get_kernel(batch->contexts[0], radii[i]);
+        if (!kernel) {
+            return -2; // Invalid radius
+        }
+        fimd_cpu_release_kernel(batch->contexts[0], radii[i], kernel);
+    }
+
+    batch->job_frames = frames;
+    batch->job_radii = radii;
+    batch->job_radii_count = radii_count;
+    batch->job_results = results;
+    batch->job_overflow = 0;
+    fimd_pool_run(batch->pool, fimd_cpu_batch_task, batch, frames_count);
+
+    return (batch->job_overflow) ? -1 : 0;
+}
+
+void fimd_cpu_batch_destroy(fimd_cpu_batch_t* batch)
+{
+    if (!batch) {
+        return;
+    }
+    fimd_pool_destroy(batch->pool);
+    if (batch->contexts) {
+        for (unsigned i = 0; i < batch->contexts_count; i++) {
+            fimd_cpu_ctx_destroy(batch->contexts[i]);
+        }
+        free(batch->contexts);
+    }
+    pthread_mutex_destroy(&batch->lock);
+    free(batch);
+}
+
+const char* fimd_cpu_get_isa() {
+    return fimd_cpu_get_isa_variant()->name;
+}
+
+int fimd_cpu_set_isa(const char* name) {
+    // finish the automatic selection first, so that it cannot override the requested variant later
+    pthread_once(&fimd_cpu_isa_once, fimd_cpu_isa_init);
+    for (unsigned i = 0; i < FIMD_ISA_COUNT; i++) {
+        if (strcmp(fimd_cpu_isa_list[i].name, name) == 0) {
+            if (!fimd_cpu_isa_supported(i)) {
+                return -1; // Not supported by the CPU
+            }
+            fimd_cpu_isa = &fimd_cpu_isa_list[i];
+            return 0;
+        }
+    }
+    return -2; // Unknown instruction set variant
+}
+
+const unsigned fimd_cpu_image_width() {
+    return fimd_cpu_resolutions[0].width;
+}
+
+const unsigned fimd_cpu_image_height() {
+    return fimd_cpu_resolutions[0].height;
+}
+
+const unsigned fimd_cpu_image_stride() {
+    return fimd_cpu_resolutions[0].stride;
+}
+
+unsigned fimd_cpu_ctx_get_image_width(const fimd_cpu_ctx_t* ctx) {
+    return ctx->resolution.width;
+}
+
+unsigned fimd_cpu_ctx_get_image_height(const fimd_cpu_ctx_t* ctx) {
+    return ctx->resolution.height;
+}
+
+unsigned fimd_cpu_ctx_get_image_stride(const fimd_cpu_ctx_t* ctx) {
+    return ctx->resolution.stride;
+}
+
+const unsigned fimd_cpu_get_resolutions_count() {
+    return FIMD_RESOLUTIONS_COUNT;
+}
+
+int fimd_cpu_get_resolution(unsigned index, unsigned* width, unsigned* height, unsigned* stride) {
+    if (index >= FIMD_RESOLUTIONS_COUNT) {
+        return -2; // Invalid index
+    }
+    *width = fimd_cpu_resolutions[index].width;
+    *height = fimd_cpu_resolutions[index].height;
+    *stride = fimd_cpu_resolutions[index].stride;
+    return 0;
+}
+
+const unsigned fimd_cpu_get_radii_count() {
+    return FIMD_RADII_COUNT;
+}
+
+const unsigned* fimd_cpu_get_radii() {
+    return fimd_radii_list;
+}
+
+const unsigned fimd_cpu_get_max_markers_count() {
+    return FIMD_MAX_MARKERS_COUNT;
+}
+
+const unsigned fimd_cpu_get_max_sun_points_count() {
+    return FIMD_MAX_SUN_PTS_COUNT;
+}
+
+const unsigned fimd_cpu_get_threshold_marker() {
+    return fimd_cpu_thresholds.center;
+}
+
+const unsigned fimd_cpu_get_threshold_sun() {
+    return fimd_cpu_thresholds.sun;
+}
+
+const unsigned fimd_cpu_get_threshold_diff() {
+    return fimd_cpu_thresholds.diff;
+}
+
+int fimd_cpu_set_threshold_marker(unsigned threshold) {
+    if (threshold > UINT8_MAX) {
+        return -2; // Invalid threshold
+    }
+    fimd_cpu_thresholds.center = (uint8_t) threshold;
+    return 0;
+}
+
+int fimd_cpu_set_threshold_sun(unsigned threshold) {
+    if (threshold > UINT8_MAX) {
+        return -2; // Invalid threshold
+    }
+    fimd_cpu_thresholds.sun = (uint8_t) threshold;
+    return 0;
+}
+
+int fimd_cpu_set_threshold_diff(unsigned threshold) {
+    if (threshold > UINT8_MAX) {
+        return -2; // Invalid threshold
+    }
+    fimd_cpu_thresholds.diff = (uint8_t) threshold;
+    return 0;
+}
+
+void fimd_cpu_jit_clear() {
+#ifdef FIMD_JIT
+    fimd_jit_clear();
+#endif
 }
 
 const unsigned fimd_cpu_get_termination_sequence() {
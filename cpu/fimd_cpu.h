@@ -9,10 +9,138 @@
 #ifndef FIMD_CPU_H
 #define FIMD_CPU_H
 
+#include <stdint.h>
+
+/**
+ * \brief Opaque FIMD-CPU detector context.
+ *
+ * The context owns an aligned scratch frame and the arrays for the raw detection results, so that repeated detections
+ * (e.g., for every radius of every frame) do not allocate any memory on the heap or large buffers on the stack.
+ */
+typedef struct fimd_cpu_ctx_s fimd_cpu_ctx_t;
+
+/**
+ * \brief Coordinates of a single detection in pixels (4 bytes per point).
+ */
+typedef struct fimd_cpu_point_s {
+    uint16_t x;
+    uint16_t y;
+} fimd_cpu_point_t;
+
+/**
+ * \brief Caller-owned output buffer of detections with an append cursor.
+ *
+ * The detections are appended at data[count] and count is advanced, so that the results of several detections
+ * (e.g., for all radii) can be collected in a single buffer without copying. The buffer is never reallocated.
+ */
+typedef struct fimd_cpu_points_s {
+    // caller-owned array of at least capacity points
+    fimd_cpu_point_t* data;
+    unsigned capacity;
+    // number of valid points in the array (cursor of the next detection)
+    unsigned count;
+} fimd_cpu_points_t;
+
+/**
+ * \brief Blob of the sun points with overlapping circles (aggregated during the scan).
+ */
+typedef struct fimd_cpu_sun_blob_s {
+    // bounding box of the sun points (inclusive)
+    uint16_t x_min;
+    uint16_t y_min;
+    uint16_t x_max;
+    uint16_t y_max;
+    // number of the sun points in the blob
+    uint32_t count;
+    // sums of the coordinates of the sun points (exact during the aggregation)
+    uint64_t x_sum;
+    uint64_t y_sum;
+    // centroid of the sun points (computed once from the sums when the blobs are reported)
+    float x;
+    float y;
+} fimd_cpu_sun_blob_t;
+
+// Number of the fractional bits of the sub-pixel coordinates of the marker centroids (1/256 px)
+#define FIMD_CPU_CENTROID_FRAC_BITS 8
+
+/**
+ * \brief Marker with the intensity-weighted centroid of its interior pixels (accumulated during the scan).
+ */
+typedef struct fimd_cpu_centroid_s {
+    // coordinates of the peak in pixels (the same as the markers of the other detection functions)
+    uint16_t x;
+    uint16_t y;
+    // sub-pixel coordinates of the centroid in the fixed point (x / (1 << FIMD_CPU_CENTROID_FRAC_BITS) pixels)
+    uint32_t cx;
+    uint32_t cy;
+    // sum of the intensities of the interior pixels
+    uint32_t weight;
+} fimd_cpu_centroid_t;
+
+/**
+ * \brief Rectangular region of interest in the image (in pixels).
+ */
+typedef struct fimd_cpu_roi_s {
+    unsigned x;
+    unsigned y;
+    unsigned width;
+    unsigned height;
+} fimd_cpu_roi_t;
+
+/**
+ * \brief Opaque FIMD-CPU tracking detector (detector context with the tracks of the markers of the previous frames).
+ */
+typedef struct fimd_cpu_tracker_s fimd_cpu_tracker_t;
+
+/**
+ * \brief Policy of the full frame scans of the tracking detector.
+ */
+typedef struct fimd_cpu_tracker_policy_s {
+    // the full frame is scanned every full_scan_interval frames (0: only when a track is lost)
+    unsigned full_scan_interval;
+    // distance in pixels from the predicted position of a marker, within which it is searched for and matched
+    unsigned window_margin;
+    // number of consecutive frames in which a track may be missed before it is lost
+    unsigned max_missed_frames;
+    // when a track is lost, the current frame is scanned again (1), or the full scan waits for the next frame (0)
+    int rescan_on_loss;
+} fimd_cpu_tracker_policy_t;
+
+/**
+ * \brief Opaque FIMD-CPU batch detector (thread pool with one detector context per thread).
+ */
+typedef struct fimd_cpu_batch_s fimd_cpu_batch_t;
+
+/**
+ * \brief Location of the detections of a single frame and radius in the results arena of the batch detection.
+ */
+typedef struct fimd_cpu_batch_entry_s {
+    // index of the first marker in the markers arena and the number of markers
+    unsigned markers_offset;
+    unsigned markers_count;
+    // index of the first sun point in the sun points arena and the number of sun points
+    unsigned sun_pts_offset;
+    unsigned sun_pts_count;
+} fimd_cpu_batch_entry_t;
+
+/**
+ * \brief Caller-owned results arena of the batch detection.
+ *
+ * The detections of all frames and radii are appended to the two point buffers (in the order of completion,
+ * not in the order of the frames) and located by the entries, one per frame and radius.
+ */
+typedef struct fimd_cpu_batch_results_s {
+    fimd_cpu_points_t markers;
+    fimd_cpu_points_t sun_pts;
+    // caller-owned array of frames_count * radii_count entries, the entry of frame f and radius i is entries[f * radii_count + i]
+    fimd_cpu_batch_entry_t* entries;
+} fimd_cpu_batch_results_t;
+
 /**
  * \brief Detects markers and sun points in a given image.
  *
  * This function processes a grayscale image to detect markers and sun points based on the specified radius.
+ * Each calling thread gets a context of the default resolution on its first call, which is reused by the next calls.
  *
  * \param radius The radius used for detection.
  * \param img_ptr Pointer to the image data (grayscale, 8-bit per pixel).
@@ -25,19 +153,529 @@
 int fimd_cpu_detect(unsigned radius, const unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num);
 
 /**
- * \brief Gets the width of the image used in the FIMD-CPU detection.
+ * \brief Creates a new FIMD-CPU detector context.
+ *
+ * All memory required by the detection is allocated (and pre-faulted) here, the context can then be reused for any number of detections.
+ *
+ * The context detects in the images of the default resolution (see fimd_cpu_image_width() and fimd_cpu_image_height()).
+ *
+ * \return Pointer to the new context, or NULL on memory allocation error.
+ */
+fimd_cpu_ctx_t* fimd_cpu_ctx_create();
+
+/**
+ * \brief Creates a new FIMD-CPU detector context for images of the given resolution.
+ *
+ * The resolution must be one of the resolutions given at the build time (see fimd_cpu_get_resolution()),
+ * the context then uses the kernels generated for its row pitch. If the library is built with the runtime kernel
+ * emitter (FIMD_JIT), any other resolution is accepted as well and served by the emitted kernels
+ * (see fimd_cpu_jit_clear()), the detection functions without an emitted counterpart then return -2.
+ *
+ * \param width Width of the image in pixels.
+ * \param height Height of the image in pixels.
+ * \param stride Row pitch of the image in bytes, or 0 for the first resolution of the given width and height.
+ * \return Pointer to the new context, or NULL if the resolution is not supported or on memory allocation error.
+ */
+fimd_cpu_ctx_t* fimd_cpu_ctx_create_resolution(unsigned width, unsigned height, unsigned stride);
+
+/**
+ * \brief Detects markers and sun points in a given image using a detector context.
+ *
+ * Same as fimd_cpu_detect(), but the scratch frame and the result arrays of the given context are used.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param radius The radius used for detection.
+ * \param img_ptr Pointer to the image data (grayscale, 8-bit per pixel).
+ * \param markers Array to store the detected markers' coordinates. Each marker is represented by a pair of coordinates (x, y).
+ * \param markers_num Pointer to an unsigned integer to store the number of detected markers.
+ * \param sun_pts Array to store the detected sun points' coordinates. Each sun point is represented by a pair of coordinates (x, y).
+ * \param sun_pts_num Pointer to an unsigned integer to store the number of detected sun points.
+ * \return An integer indicating the success or failure of the detection process. Returns 0 on success and -2 on invalid radius.
+ */
+int fimd_cpu_ctx_detect(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num);
+
+/**
+ * \brief Detects markers and sun points directly in a caller-owned image buffer (destructive, no copy).
+ *
+ * The detection runs straight on the given buffer instead of a scratch copy. The buffer is modified during
+ * the detection: interior pixels of the detected markers and sun points are set to 0 and the termination sequence
+ * is written into it. Use only if the image is not needed after the detection.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param radius The radius used for detection.
+ * \param img_ptr Pointer to the mutable image data (grayscale, 8-bit per pixel), contents are destroyed.
+ * \param markers Array to store the detected markers' coordinates. Each marker is represented by a pair of coordinates (x, y).
+ * \param markers_num Pointer to an unsigned integer to store the number of detected markers.
+ * \param sun_pts Array to store the detected sun points' coordinates. Each sun point is represented by a pair of coordinates (x, y).
+ * \param sun_pts_num Pointer to an unsigned integer to store the number of detected sun points.
+ * \return An integer indicating the success or failure of the detection process. Returns 0 on success and -2 on invalid radius.
+ */
+int fimd_cpu_ctx_detect_inplace(fimd_cpu_ctx_t* ctx, unsigned radius, unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num);
+
+/**
+ * \brief Detects markers and sun points in an image with 10, 12 or 16 bits per pixel using a detector context.
+ *
+ * Same as fimd_cpu_ctx_detect_const(): the image is not modified and the results are identical, but the frame
+ * is copied into a 16-bit scratch frame of the context, which is scanned by the kernels generated for 16-bit pixels.
+ * The row pitch of the context is in pixels (not bytes) and the pixel values are right-aligned in the 16-bit words.
+ * The thresholds (0-255) are scaled by the pixel depth, so an 8-bit image shifted left by (bits - 8) gives
+ * the results of fimd_cpu_ctx_detect_const() of the 8-bit image.
+ * The read-only, parallel, fused and JIT paths support 8-bit pixels only.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param radius The radius used for detection.
+ * \param img_ptr Pointer to the image data (grayscale, 16-bit words per pixel), not modified.
+ * \param bits Number of significant bits per pixel (8 to 16).
+ * \param markers Array to store the detected markers' coordinates. Each marker is represented by a pair of coordinates (x, y).
+ * \param markers_num Pointer to an unsigned integer to store the number of detected markers.
+ * \param sun_pts Array to store the detected sun points' coordinates. Each sun point is represented by a pair of coordinates (x, y).
+ * \param sun_pts_num Pointer to an unsigned integer to store the number of detected sun points.
+ * \return An integer indicating the success or failure of the detection process. Returns 0 on success, -1 on memory allocation error
+ * and -2 on invalid radius or pixel depth (or if the library was built without the 16-bit kernels).
+ */
+int fimd_cpu_ctx_detect16(fimd_cpu_ctx_t* ctx, unsigned radius, const uint16_t* img_ptr, unsigned bits, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num);
+
+/**
+ * \brief Detects markers and sun points in a read-only image without copying it.
+ *
+ * The bounded kernel stops at the end of the image or when a limit on the number of detections is reached,
+ * no termination sequence is used. The interior pixels of the detections are suppressed in a bitmap owned
+ * by the context instead of being zeroed in the image. The results are identical to fimd_cpu_ctx_detect(),
+ * except that the pixel data equal to the termination sequence do not stop the detection.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param radius The radius used for detection.
+ * \param img_ptr Pointer to the image data (grayscale, 8-bit per pixel), not modified.
+ * \param markers Array to store the detected markers' coordinates. Each marker is represented by a pair of coordinates (x, y).
+ * \param markers_num Pointer to an unsigned integer to store the number of detected markers.
+ * \param sun_pts Array to store the detected sun points' coordinates. Each sun point is represented by a pair of coordinates (x, y).
+ * \param sun_pts_num Pointer to an unsigned integer to store the number of detected sun points.
+ * \return An integer indicating the success or failure of the detection process. Returns 0 on success and -2 on invalid radius.
+ */
+int fimd_cpu_ctx_detect_const(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num);
+
+/**
+ * \brief Detects markers and sun points in a read-only image and appends their coordinates to caller-owned buffers.
+ *
+ * Same detection as fimd_cpu_ctx_detect_const(), but the kernel writes packed 16-bit coordinates directly
+ * into the given buffers (the row of the central pixel is tracked during the scan, no per-point division).
+ * The limits on the number of markers and sun points apply to this detection only, and they are further
+ * reduced to the free space of the buffers: the detection stops when a buffer becomes full.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param radius The radius used for detection.
+ * \param img_ptr Pointer to the image data (grayscale, 8-bit per pixel), not modified.
+ * \param markers Buffer to append the detected markers to (peak coordinates), count is advanced.
+ * \param sun_pts Buffer to append the detected sun points to, count is advanced.
+ * \return An integer indicating the success or failure of the detection process. Returns 0 on success and -2 on invalid radius.
+ */
+int fimd_cpu_ctx_detect_points(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, fimd_cpu_points_t* markers, fimd_cpu_points_t* sun_pts);
+
+/**
+ * \brief Sets the static map of the defective pixels (hot, stuck or dead pixels) of the sensor.
+ *
+ * The defects never pass the threshold: they are zeroed in the internal copies of the frames (and in the image
+ * of fimd_cpu_ctx_detect_inplace()) and permanently suppressed in the bitmaps of the read-only detection, so they are
+ * neither tested as central pixels nor counted as bright pixels of the other circles. The results equal the detection
+ * in the image with the defects set to zero. The map applies to all detection functions of the context and replaces
+ * the previous one. The batch detector (fimd_cpu_batch_t) has no defect map.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param defects Array of the defect coordinates (x, y), duplicates are allowed.
+ * \param defects_count Number of the defects, 0 clears the map.
+ * \return Returns 0 on success, -1 on memory allocation error and -2 on coordinates outside the image.
+ */
+int fimd_cpu_ctx_set_defects(fimd_cpu_ctx_t* ctx, const unsigned defects[][2], unsigned defects_count);
+
+/**
+ * \brief Sets the static map of the defective pixels from a bitmap (see fimd_cpu_ctx_set_defects()).
+ *
+ * \param ctx Pointer to the detector context.
+ * \param bitmap One bit per pixel in the row order without the padding (pixel (x, y) is bit (y*width + x) % 8
+ *        of byte (y*width + x) / 8), NULL clears the map.
+ * \return Returns 0 on success and -1 on memory allocation error.
+ */
+int fimd_cpu_ctx_set_defect_map(fimd_cpu_ctx_t* ctx, const uint8_t* bitmap);
+
+/**
+ * \brief Enables the temporal mask of the sun regions for the read-only detection of the context.
+ *
+ * The image is divided into cells of cell_size x cell_size pixels. Each cell with a sun point detected
+ * by fimd_cpu_ctx_detect_const() or fimd_cpu_ctx_detect_points() is masked for the following hold_count detections
+ * of the context: the central pixels of the masked cells are skipped entirely (no markers nor sun points are detected
+ * there), while their pixels are still read by the boundary tests of the other central pixels. A masked cell is scanned
+ * again after it expires and masked again if the sun points are still present. The mask is aged by every detection,
+ * so with several radii per frame the hold count covers the detections of all radii.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param cell_size Size of the cells in pixels.
+ * \param hold_count Number of the detections for which a cell is skipped (1 to 255), 0 disables the mask.
+ * \return Returns 0 on success, -1 on memory allocation error and -2 on invalid parameters.
+ */
+int fimd_cpu_ctx_set_sun_mask(fimd_cpu_ctx_t* ctx, unsigned cell_size, unsigned hold_count);
+
+/**
+ * \brief Gets the temporal mask of the sun regions (remaining number of the detections for which each cell is skipped).
+ *
+ * \param ctx Pointer to the detector context.
+ * \param cols Pointer to store the number of the cells in a row (0 if the mask is disabled).
+ * \param rows Pointer to store the number of the rows of the cells (0 if the mask is disabled).
+ * \return Pointer to the cells in the row order, or NULL if the mask is disabled.
+ */
+const uint8_t* fimd_cpu_ctx_get_sun_mask(const fimd_cpu_ctx_t* ctx, unsigned* cols, unsigned* rows);
+
+/**
+ * \brief Detects markers in a read-only image with the sub-pixel centroids of their interiors.
+ *
+ * Same detection as fimd_cpu_ctx_detect_const(), but the marker path of the kernel also accumulates the intensity-weighted
+ * sums of the interior coordinates while searching for the peak, so no second pass over the frame is needed.
+ * The centroid covers the same interior pixels as the peak search, i.e., the forward half of the disk in the scan order
+ * (the central row from the central pixel to the right and all rows below it), which contains the whole spot
+ * of the marker first reached by the scan. The pixels beyond the left or right image border are not excluded.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param radius Radius of the circle.
+ * \param img_ptr Pointer to the image data (not modified).
+ * \param markers Array to store the detected markers with the centroids (at least fimd_cpu_get_max_markers_count() entries).
+ * \param markers_num Pointer to store the number of detected markers.
+ * \param sun_pts Array to store the detected sun points coordinates.
+ * \param sun_pts_num Pointer to store the number of detected sun points.
+ * \return An integer indicating the success or failure of the detection process. Returns 0 on success and -2 on invalid radius.
+ */
+int fimd_cpu_ctx_detect_centroids(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, fimd_cpu_centroid_t markers[], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num);
+
+/**
+ * \brief Detects markers in a read-only image and aggregates the sun points into blobs during the scan.
+ *
+ * Same detection as fimd_cpu_ctx_detect_const(), but the sun points are merged into connected blobs in the row order
+ * of the scan instead of being reported one by one: two sun points belong to the same blob if they are at most
+ * 2 * radius pixels apart in both axes (their circles overlap). The sun points are aggregated in small chunks,
+ * hence the limit on the number of sun points does not apply. The sun points which would start a new blob
+ * after blobs_max blobs are found are dropped. The blobs are ordered by their first sun point in the scan order.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param radius The radius used for detection.
+ * \param img_ptr Pointer to the image data (grayscale, 8-bit per pixel), not modified.
+ * \param markers Array to store the detected markers' coordinates. Each marker is represented by a pair of coordinates (x, y).
+ * \param markers_num Pointer to an unsigned integer to store the number of detected markers.
+ * \param blobs Array to store the sun blobs (at least blobs_max).
+ * \param blobs_max Capacity of the array of the sun blobs.
+ * \param blobs_num Pointer to an unsigned integer to store the number of the sun blobs.
+ * \return An integer indicating the success or failure of the detection process. Returns 0 on success and -2 on invalid radius.
+ */
+int fimd_cpu_ctx_detect_blobs(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, fimd_cpu_sun_blob_t blobs[], unsigned blobs_max, unsigned* blobs_num);
+
+/**
+ * \brief Detects markers and sun points only inside the given regions of interest of a read-only image.
+ *
+ * The bounded kernel tests only the central pixels inside the regions, clamped to the radius margin of the image
+ * (the circle of each tested pixel lies inside the image). Overlapping and adjacent regions are merged row by row,
+ * so every central pixel is tested at most once and in the order of the full frame scan, and the detections on the
+ * shared edges are reported only once. The detections are identical to fimd_cpu_ctx_detect_const() restricted to the
+ * central pixels inside the regions, unless a detection outside the regions overlaps them. The limits on the number
+ * of markers and sun points apply to all regions together.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param radius The radius used for detection.
+ * \param img_ptr Pointer to the image data (grayscale, 8-bit per pixel), not modified.
+ * \param rois Array of the regions of interest (may overlap or extend beyond the image).
+ * \param rois_count Number of the regions of interest.
+ * \param markers Array to store the detected markers' coordinates. Each marker is represented by a pair of coordinates (x, y).
+ * \param markers_num Pointer to an unsigned integer to store the number of detected markers.
+ * \param sun_pts Array to store the detected sun points' coordinates. Each sun point is represented by a pair of coordinates (x, y).
+ * \param sun_pts_num Pointer to an unsigned integer to store the number of detected sun points.
+ * \return An integer indicating the success or failure of the detection process. Returns 0 on success, -1 on memory allocation error
+ *         (only for more than 64 regions) and -2 on invalid radius.
+ */
+int fimd_cpu_ctx_detect_roi(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, const fimd_cpu_roi_t rois[], unsigned rois_count, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num);
+
+/**
+ * \brief Detects markers and sun points directly in a read-only frame packed as MIPI CSI-2 RAW10 or RAW12.
+ *
+ * The frame is not unpacked as a whole. The central pixel threshold is tested on the high bytes of the packed rows
+ * (the 8 most significant bits of each pixel), and only the chunks of the rows around the pixels above the threshold
+ * are unpacked into the scratch frame of the context, row by row in a single pass over the packed frame. The bounded
+ * kernel then tests only these pixels, so the detections are identical to fimd_cpu_ctx_detect_const() of the 8-bit
+ * frame of the high bytes. The low bits are ignored and the temporal sun mask does not apply to this detection.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param radius The radius used for detection.
+ * \param packed_ptr Pointer to the packed frame (RAW10: 4 pixels in 5 bytes, RAW12: 2 pixels in 3 bytes), not modified.
+ * \param bits Number of bits per pixel of the packed format (10 or 12), the image width must be a multiple of the pixels per group.
+ * \param packed_stride Row pitch of the packed frame in bytes (0 if the rows are not padded).
+ * \param markers Array to store the detected markers' coordinates. Each marker is represented by a pair of coordinates (x, y).
+ * \param markers_num Pointer to an unsigned integer to store the number of detected markers.
+ * \param sun_pts Array to store the detected sun points' coordinates. Each sun point is represented by a pair of coordinates (x, y).
+ * \param sun_pts_num Pointer to an unsigned integer to store the number of detected sun points.
+ * \return An integer indicating the success or failure of the detection process. Returns 0 on success, -1 on memory allocation error
+ *         and -2 on invalid radius or packing.
+ */
+int fimd_cpu_ctx_detect_packed(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* packed_ptr, unsigned bits, unsigned packed_stride, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num);
+
+/**
+ * \brief Detects markers and sun points for all compiled radii in a single image pass.
+ *
+ * The fused kernel tests the central pixel threshold only once per pixel. Candidates are then tested for all radii
+ * in ascending order and each detection is tagged with the smallest matching radius (similar to FIMD-GPU).
+ * The limits on the number of markers and sun points apply to the merged lists.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param img_ptr Pointer to the image data (grayscale, 8-bit per pixel).
+ * \param markers Array to store the detected markers. Each marker is represented by its coordinates and the matching radius (x, y, r).
+ * \param markers_num Pointer to an unsigned integer to store the number of detected markers.
+ * \param sun_pts Array to store the detected sun points. Each sun point is represented by its coordinates and the matching radius (x, y, r).
+ * \param sun_pts_num Pointer to an unsigned integer to store the number of detected sun points.
+ * \return Returns 0 on success and -2 if no kernels were generated for the resolution of the context.
+ */
+int fimd_cpu_ctx_detect_fused(fimd_cpu_ctx_t* ctx, const unsigned char* img_ptr, unsigned markers[][3], unsigned* markers_num, unsigned sun_pts[][3], unsigned* sun_pts_num);
+
+/**
+ * \brief Sets the number of threads used by fimd_cpu_ctx_detect_parallel().
+ *
+ * Creates a persistent thread pool (threads_count-1 worker threads, the calling thread participates in the detection)
+ * and allocates one stripe buffer and one suppression bitmap per thread (also used by fimd_cpu_ctx_detect_radii()). Any previous thread pool of the context is released.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param threads_count Number of threads, values 0 and 1 disable the parallel detection.
+ * \return Returns 0 on success, -1 on memory allocation or thread creation error.
+ */
+int fimd_cpu_ctx_set_threads_count(fimd_cpu_ctx_t* ctx, unsigned threads_count);
+
+/**
+ * \brief Gets the number of threads used by fimd_cpu_ctx_detect_parallel().
+ *
+ * \param ctx Pointer to the detector context.
+ * \return The number of threads (1 if the parallel detection is disabled).
+ */
+unsigned fimd_cpu_ctx_get_threads_count(const fimd_cpu_ctx_t* ctx);
+
+/**
+ * \brief Detects markers and sun points in a given image using multiple threads.
+ *
+ * The image is split into horizontal stripes (one per thread) and the generated kernel is run on a copy of each stripe
+ * extended by the halo rows of the given radius. The stripes are merged in order and a stripe is detected again
+ * whenever the serial detection would not reach it in the same state, i.e., when the interior pixels zeroed
+ * by the previous stripe reach into its halo rows, or when the limits on the number of detections are reached.
+ * Therefore, the output is always identical to fimd_cpu_ctx_detect().
+ *
+ * \param ctx Pointer to the detector context (see fimd_cpu_ctx_set_threads_count()).
+ * \param radius The radius used for detection.
+ * \param img_ptr Pointer to the image data (grayscale, 8-bit per pixel).
+ * \param markers Array to store the detected markers' coordinates. Each marker is represented by a pair of coordinates (x, y).
+ * \param markers_num Pointer to an unsigned integer to store the number of detected markers.
+ * \param sun_pts Array to store the detected sun points' coordinates. Each sun point is represented by a pair of coordinates (x, y).
+ * \param sun_pts_num Pointer to an unsigned integer to store the number of detected sun points.
+ * \return An integer indicating the success or failure of the detection process. Returns 0 on success and -2 on invalid radius.
+ */
+int fimd_cpu_ctx_detect_parallel(fimd_cpu_ctx_t* ctx, unsigned radius, const unsigned char* img_ptr, unsigned markers[][2], unsigned* markers_num, unsigned sun_pts[][2], unsigned* sun_pts_num);
+
+/**
+ * \brief Detects markers and sun points for several radii in the same read-only image concurrently.
+ *
+ * Each radius is one task of the thread pool set by fimd_cpu_ctx_set_threads_count() (serial loop without the pool).
+ * All tasks read the caller's image directly, no copy is made: the interior pixels are suppressed in the bitmap
+ * of the worker thread, so the image is never written. The results of each radius are identical
+ * to fimd_cpu_ctx_detect_points() and the limits apply to each radius separately.
+ *
+ * \param ctx Pointer to the detector context.
+ * \param radii Radii used for detection.
+ * \param radii_count Number of radii.
+ * \param img_ptr Pointer to the image data (grayscale, 8-bit per pixel), not modified.
+ * \param markers Buffers to append the detected markers of each radius to (one per radius), counts are advanced.
+ * \param sun_pts Buffers to append the detected sun points of each radius to (one per radius), counts are advanced.
+ * \return Returns 0 on success and -2 on invalid radius (no radius is detected then).
+ *
+ * \note The temporal mask of the sun regions (fimd_cpu_ctx_set_sun_mask()) is neither applied nor updated.
+ */
+int fimd_cpu_ctx_detect_radii(fimd_cpu_ctx_t* ctx, const unsigned radii[], unsigned radii_count, const unsigned char* img_ptr, fimd_cpu_points_t markers[], fimd_cpu_points_t sun_pts[]);
+
+/**
+ * \brief Destroys the FIMD-CPU detector context and releases associated memory.
+ *
+ * \param ctx Pointer to the detector context (may be NULL).
+ */
+void fimd_cpu_ctx_destroy(fimd_cpu_ctx_t* ctx);
+
+/**
+ * \brief Gets the width of the images of the detector context.
+ *
+ * \param ctx Pointer to the detector context.
+ * \return The width of the image in pixels.
+ */
+unsigned fimd_cpu_ctx_get_image_width(const fimd_cpu_ctx_t* ctx);
+
+/**
+ * \brief Gets the height of the images of the detector context.
+ *
+ * \param ctx Pointer to the detector context.
+ * \return The height of the image in pixels.
+ */
+unsigned fimd_cpu_ctx_get_image_height(const fimd_cpu_ctx_t* ctx);
+
+/**
+ * \brief Gets the row pitch of the images of the detector context.
+ *
+ * All image buffers passed to the detection functions of the context hold stride * height bytes.
+ *
+ * \param ctx Pointer to the detector context.
+ * \return The distance between the starts of two consecutive rows in bytes.
+ */
+unsigned fimd_cpu_ctx_get_image_stride(const fimd_cpu_ctx_t* ctx);
+
+/**
+ * \brief Creates a tracking detector for the video of the given resolution.
+ *
+ * The tracking detector keeps the markers detected in the previous frames as tracks with a constant velocity
+ * prediction. In most frames, only the windows around the predicted positions are detected (see fimd_cpu_ctx_detect_roi())
+ * and the full frame is scanned (see fimd_cpu_ctx_detect_const()) only according to the policy: in the first frame,
+ * every full_scan_interval frames and when a track is lost.
+ *
+ * \param width Width of the images in pixels.
+ * \param height Height of the images in pixels.
+ * \param stride Row pitch of the images in bytes, or 0 (see fimd_cpu_ctx_create_resolution()).
+ * \param radii Array of the radii used for detection (copied).
+ * \param radii_count Number of the radii.
+ * \param policy Policy of the full frame scans (copied), or NULL for the default policy
+ *        (full scan every 30 frames, window margin 8 px, no missed frames, rescan on loss).
+ * \return Pointer to the new tracking detector, or NULL if the resolution is not supported or on memory allocation error.
+ */
+fimd_cpu_tracker_t* fimd_cpu_tracker_create(unsigned width, unsigned height, unsigned stride, const unsigned radii[], unsigned radii_count, const fimd_cpu_tracker_policy_t* policy);
+
+/**
+ * \brief Detects markers and sun points in the next frame of the video using the tracks of the previous frames.
+ *
+ * The detections of all radii are reported in the order of the radii, each as (x, y, r), the markers detected
+ * for several radii are reported for each of them (as by the detection of each radius). In the frames without
+ * the full scan, only the markers and sun points inside the windows are detected, new markers are found
+ * by the next full scan. The limits on the number of markers and sun points apply to the merged lists.
+ *
+ * \param tracker Pointer to the tracking detector.
+ * \param img_ptr Pointer to the image data (grayscale, 8-bit per pixel), not modified.
+ * \param markers Array to store the detected markers. Each marker is represented by its coordinates and the radius (x, y, r).
+ * \param markers_num Pointer to an unsigned integer to store the number of detected markers.
+ * \param sun_pts Array to store the detected sun points. Each sun point is represented by its coordinates and the radius (x, y, r).
+ * \param sun_pts_num Pointer to an unsigned integer to store the number of detected sun points.
+ * \return Returns 0 if only the windows were detected, 1 if the full frame was scanned, -1 on memory allocation error
+ *         and -2 on invalid radius.
+ */
+int fimd_cpu_tracker_detect(fimd_cpu_tracker_t* tracker, const unsigned char* img_ptr, unsigned markers[][3], unsigned* markers_num, unsigned sun_pts[][3], unsigned* sun_pts_num);
+
+/**
+ * \brief Drops all tracks, so that the next frame is scanned fully (e.g., after a cut in the video).
+ *
+ * \param tracker Pointer to the tracking detector.
+ */
+void fimd_cpu_tracker_reset(fimd_cpu_tracker_t* tracker);
+
+/**
+ * \brief Gets the number of the markers currently tracked.
+ *
+ * \param tracker Pointer to the tracking detector.
+ * \return The number of tracks (including the tracks missed in the last frames).
+ */
+unsigned fimd_cpu_tracker_get_tracks_count(const fimd_cpu_tracker_t* tracker);
+
+/**
+ * \brief Destroys the tracking detector and releases associated memory.
+ *
+ * \param tracker Pointer to the tracking detector (may be NULL).
+ */
+void fimd_cpu_tracker_destroy(fimd_cpu_tracker_t* tracker);
+
+/**
+ * \brief Creates a batch detector for offline processing of many frames of the given resolution.
+ *
+ * The batch detector owns a persistent thread pool and one detector context (scratch frame and result arrays)
+ * per thread, so that the frames are detected concurrently without any allocation.
+ *
+ * \param width Width of the images in pixels.
+ * \param height Height of the images in pixels.
+ * \param stride Row pitch of the images in bytes, or 0 (see fimd_cpu_ctx_create_resolution()).
+ * \param threads_count Number of threads including the calling thread, or 0 for the number of online processors.
+ * \return Pointer to the new batch detector, or NULL if the resolution is not supported, on memory allocation
+ *         or thread creation error.
+ */
+fimd_cpu_batch_t* fimd_cpu_batch_create(unsigned width, unsigned height, unsigned stride, unsigned threads_count);
+
+/**
+ * \brief Gets the number of threads of the batch detector.
+ *
+ * \param batch Pointer to the batch detector.
+ * \return The number of threads (including the calling thread).
+ */
+unsigned fimd_cpu_batch_get_threads_count(const fimd_cpu_batch_t* batch);
+
+/**
+ * \brief Detects markers and sun points in many frames for each of the given radii using all threads.
+ *
+ * Each frame is a task of the thread pool, which runs the detection of fimd_cpu_ctx_detect() for all radii
+ * on the scratch context of its worker. The detections are appended to the results arena and located by its entries.
+ * The output of each frame and radius is identical to fimd_cpu_ctx_detect(), only the positions in the arena
+ * depend on the scheduling. If the arena is full, the remaining detections are dropped (the counts of the entries
+ * include only the stored detections). No other detection may change the thresholds during the batch.
+ *
+ * \param batch Pointer to the batch detector.
+ * \param frames Array of pointers to the image data (grayscale, 8-bit per pixel), not modified.
+ * \param frames_count Number of frames.
+ * \param radii Array of radii used for detection.
+ * \param radii_count Number of radii.
+ * \param results Results arena, the entries array must hold frames_count * radii_count entries.
+ * \return Returns 0 on success, -1 if the arena is too small for all detections and -2 on invalid radius
+ *         (no frame is then processed).
+ */
+int fimd_cpu_batch_detect(fimd_cpu_batch_t* batch, const unsigned char* const frames[], unsigned frames_count, const unsigned radii[], unsigned radii_count, fimd_cpu_batch_results_t* results);
+
+/**
+ * \brief Destroys the batch detector, its threads and contexts.
+ *
+ * \param batch Pointer to the batch detector (may be NULL).
+ */
+void fimd_cpu_batch_destroy(fimd_cpu_batch_t* batch);
+
+/**
+ * \brief Gets the count of image resolutions supported by the library.
+ *
+ * \return The number of resolutions given at the build time.
+ */
+const unsigned fimd_cpu_get_resolutions_count();
+
+/**
+ * \brief Gets an image resolution supported by the library.
+ *
+ * \param index Index of the resolution, the index 0 is the default resolution.
+ * \param width Pointer to store the width of the image in pixels.
+ * \param height Pointer to store the height of the image in pixels.
+ * \param stride Pointer to store the row pitch of the image in bytes.
+ * \return 0 on success, -2 on invalid index.
+ */
+int fimd_cpu_get_resolution(unsigned index, unsigned* width, unsigned* height, unsigned* stride);
+
+/**
+ * \brief Gets the width of the image of the default resolution.
  *
  * \return The width of the image in pixels.
  */
 const unsigned fimd_cpu_image_width();
 
 /**
- * \brief Gets the height of the image used in the FIMD-CPU detection.
+ * \brief Gets the height of the image of the default resolution.
  *
  * \return The height of the image in pixels.
  */
 const unsigned fimd_cpu_image_height();
 
+/**
+ * \brief Gets the row pitch of the image of the default resolution.
+ *
+ * All image buffers passed to fimd_cpu_detect() and to the detection functions of the contexts created by fimd_cpu_ctx_create()
+ * hold fimd_cpu_image_stride() * fimd_cpu_image_height() bytes.
+ * The padding bytes at the end of each row are treated as dark pixels, the coordinates of the detections
+ * are always given in pixels.
+ *
+ * \return The distance between the starts of two consecutive rows in bytes (at least the image width).
+ */
+const unsigned fimd_cpu_image_stride();
+
 /**
  * \brief Gets the count of radii used in the FIMD-CPU detection.
  *
@@ -87,6 +725,50 @@ const unsigned fimd_cpu_get_threshold_sun();
  */
 const unsigned fimd_cpu_get_threshold_diff();
 
+/**
+ * \brief Sets the threshold value for marker detection (the central pixel must be above it).
+ *
+ * The thresholds are global to the process: they are shared by all contexts, batch and tracking detectors
+ * and threads, so different contexts cannot detect with different thresholds. The kernels read them at the start
+ * of each call, and the parallel and batch detections call a kernel per stripe or frame, hence the thresholds
+ * must not be changed while any detection is running in any thread (the values would change in the middle of
+ * a frame). The initial values are given in CMakeLists.txt.
+ *
+ * \param threshold The new threshold value (0-255).
+ * \return 0 on success, -2 on invalid threshold.
+ */
+int fimd_cpu_set_threshold_marker(unsigned threshold);
+
+/**
+ * \brief Sets the threshold value for sun point detection (see fimd_cpu_set_threshold_marker()).
+ *
+ * \param threshold The new threshold value (0-255).
+ * \return 0 on success, -2 on invalid threshold.
+ */
+int fimd_cpu_set_threshold_sun(unsigned threshold);
+
+/**
+ * \brief Sets the threshold value for the difference used in detection (see fimd_cpu_set_threshold_marker()).
+ *
+ * \param threshold The new threshold value (0-255).
+ * \return 0 on success, -2 on invalid threshold.
+ */
+int fimd_cpu_set_threshold_diff(unsigned threshold);
+
+/**
+ * \brief Releases the kernels emitted at runtime.
+ *
+ * If the library is built with the runtime kernel emitter (FIMD_JIT, x86-64 only), fimd_cpu_detect(),
+ * fimd_cpu_ctx_detect(), fimd_cpu_ctx_detect_inplace() and fimd_cpu_ctx_detect_parallel() accept any radius
+ * and resolution without generated kernels. The kernel is then emitted into executable memory for the radius,
+ * the row pitch and the current thresholds, and cached for the following detections. The cache keeps at most
+ * 32 kernels, the least recently used kernels are released when a new one is emitted (unless a running detection
+ * uses them), so changing the thresholds for every frame does not grow the memory. This function releases the whole
+ * cache, but no detection may be running at the same time.
+ * Otherwise, this function does nothing.
+ */
+void fimd_cpu_jit_clear();
+
 /**
  * \brief Gets the termination sequence value used in the FIMD-CPU detection.
  *
@@ -94,5 +776,25 @@ const unsigned fimd_cpu_get_threshold_diff();
  */
 const unsigned fimd_cpu_get_termination_sequence();
 
+/**
+ * \brief Gets the name of the instruction set variant of the kernels used by all detections.
+ *
+ * The variant is selected automatically on the first use as the most specific one supported by the CPU
+ * ("scalar", "sse4.1", "avx2" or "avx512" for the x86-64 builds with runtime dispatch).
+ *
+ * \return The name of the active instruction set variant.
+ */
+const char* fimd_cpu_get_isa();
+
+/**
+ * \brief Overrides the automatically selected instruction set variant of the kernels.
+ *
+ * Must not be called while any detection is running.
+ *
+ * \param name The name of the variant (see fimd_cpu_get_isa()).
+ * \return 0 on success, -1 if the variant is not supported by the CPU and -2 on unknown variant.
+ */
+int fimd_cpu_set_isa(const char* name);
+
 
 #endif //FIMD_CPU_H
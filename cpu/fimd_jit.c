@@ -0,0 +1,677 @@
+/**
+ * \file fimd_jit.c
+ * \author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \date December 2024
+ * \brief Source file for the runtime emitter of the FIMD-CPU kernels (x86-64, System V calling convention).
+ * \copyright GNU Public License.
+ */
+
+// MAP_ANONYMOUS and POSIX threads are not a part of C99
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "fimd_jit.h"
+
+/*
+ * The emitted kernel follows template.c with the vector skip-ahead scan of fimd_simd.h (16-pixel blocks of SSE2,
+ * available on all x86-64 CPUs, or 32-pixel blocks of AVX2 with the same instructions in the VEX encoding) and the
+ * scalar boundary and interior sequences unrolled for the given radius. Registers (ymm instead of xmm for AVX2):
+ * - rdi: current pixel pointer (img_ptr), rsi: last position for the vector scan (simd_end),
+ * - rdx, rcx: markers and markers_num, r8, r9: sun_pts and sun_pts_num (arguments of fimd_kernel_t),
+ * - eax: central pixel value (peak value in the interior search), r11d: central pixel value - threshold_diff
+ *   (peak pointer in the interior search), r10d and rbx: temporaries,
+ * - xmm4: zero, xmm5: broadcast threshold_center, xmm6, xmm7: broadcast bytes of the termination sequence,
+ *   xmm8: broadcast threshold_diff, xmm9: broadcast threshold_sun - 1,
+ * - xmm0: central pixels of the block, xmm1, xmm2: marker and sun candidates of the vector boundary test,
+ *   r10d: termination sequence mask, xmm3 and xmm10: temporaries.
+ * As in the generated kernels, the vector boundary test of the block stops the scan only before the pixels
+ * passing the whole marker or sun test (or before the termination sequence).
+ */
+
+// Condition codes of the near conditional jumps (0F 8x)
+#define FIMD_JIT_JB 0x82
+#define FIMD_JIT_JAE 0x83
+#define FIMD_JIT_JE 0x84
+#define FIMD_JIT_JNE 0x85
+#define FIMD_JIT_JBE 0x86
+#define FIMD_JIT_JL 0x8C
+#define FIMD_JIT_JGE 0x8D
+
+// Vector instructions (prefix and the second opcode byte of SSE2, same as the opcode of AVX2 in the map 0F)
+#define FIMD_JIT_MOVDQA 0x66, 0x6F
+#define FIMD_JIT_PSUBUSB 0x66, 0xD8
+#define FIMD_JIT_PCMPEQB 0x66, 0x74
+#define FIMD_JIT_PAND 0x66, 0xDB
+#define FIMD_JIT_PANDN 0x66, 0xDF
+#define FIMD_JIT_POR 0x66, 0xEB
+#define FIMD_JIT_PXOR 0x66, 0xEF
+#define FIMD_JIT_PMOVMSKB 0x66, 0xD7
+
+// Upper bounds of the code size in bytes (fixed part and per boundary or interior pixel)
+#define FIMD_JIT_CODE_FIXED 1024
+#define FIMD_JIT_CODE_BOUNDARY 112
+#define FIMD_JIT_CODE_INTERIOR 42
+
+// Buffer of the emitted code
+struct fimd_jit_code_s {
+    uint8_t* data;
+    size_t size;
+    // pixels per vector block (16: SSE2, 32: AVX2)
+    unsigned simd_width;
+};
+
+// Cached kernel with its parameters
+struct fimd_jit_entry_s {
+    unsigned radius;
+    uint32_t stride;
+    fimd_thresholds_t thresholds;
+    unsigned simd_width;
+    void* code;
+    size_t code_size;
+    fimd_kernel_t kernel;
+    // number of the detections using the kernel (it is not released from the cache while in use)
+    unsigned users;
+    struct fimd_jit_entry_s* next;
+};
+
+// cached kernels from the most to the least recently used one
+static struct fimd_jit_entry_s* fimd_jit_cache = NULL;
+static unsigned fimd_jit_cache_count = 0;
+static pthread_mutex_t fimd_jit_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * \brief Generates the boundary and interior pixels of a circle, same as bresenham_circle_points() in generate.py.
+ *
+ * \param r Radius of the circle.
+ * \param boundary Array of at least 8*(r+1) points (y, x).
+ * \param boundary_num Pointer to store the number of the boundary points.
+ * \param interior Array of at least 8*(r+1)*(r+1) points (y, x).
+ * \param interior_num Pointer to store the number of the interior points.
+ */
+static void fimd_jit_circle_points(int r, int boundary[][2], unsigned* boundary_num, int interior[][2], unsigned* interior_num)
+{
+    unsigned nb = 0, ni = 0;
+    int x = 0, y = r;
+    int p = 3 - 2*r;
+
+#define FIMD_JIT_ADD(_list, _n, _y, _x) do { (_list)[_n][0] = (_y); (_list)[_n][1] = (_x); (_n)++; } while (0)
+    while (x <= y) {
+        FIMD_JIT_ADD(boundary, nb, y, -x);
+        if (r == 0) break;
+        FIMD_JIT_ADD(boundary, nb, -y, x);
+        if (x < y) {
+            FIMD_JIT_ADD(boundary, nb, x, -y);
+            FIMD_JIT_ADD(boundary, nb, -x, y);
+        }
+        if (x > 0) {
+            FIMD_JIT_ADD(boundary, nb, y, x);
+            FIMD_JIT_ADD(boundary, nb, -y, -x);
+            if (x < y) {
+                FIMD_JIT_ADD(boundary, nb, x, y);
+                FIMD_JIT_ADD(boundary, nb, -x, -y);
+            }
+        }
+
+        for (int y_i = x; y_i < y; y_i++) {
+            FIMD_JIT_ADD(interior, ni, y_i, x);
+            if (y_i > x) {
+                FIMD_JIT_ADD(interior, ni, x, y_i);
+                FIMD_JIT_ADD(interior, ni, x, -y_i);
+            }
+            if (y_i > 0) {
+                FIMD_JIT_ADD(interior, ni, -y_i, x);
+            }
+            if (x > 0) {
+                FIMD_JIT_ADD(interior, ni, y_i, -x);
+                FIMD_JIT_ADD(interior, ni, -y_i, -x);
+                if (y_i > x) {
+                    FIMD_JIT_ADD(interior, ni, -x, y_i);
+                    FIMD_JIT_ADD(interior, ni, -x, -y_i);
+                }
+            }
+        }
+
+        if (p < 0) {
+            x += 1;
+            p += 4*x + 6;
+        } else {
+            x += 1;
+            y -= 1;
+            p += 4*(x - y) + 10;
+        }
+    }
+#undef FIMD_JIT_ADD
+
+    *boundary_num = nb;
+    *interior_num = ni;
+}
+
+/**
+ * \brief Sorts the boundary pixels into the evaluation order, same as get_boundary_evaluation_order() in generate.py.
+ *
+ * \param boundary Boundary points in the generation order.
+ * \param boundary_num Number of the boundary points.
+ * \param order Array of at least boundary_num+4 points to store the evaluation order.
+ * \return Number of the points in the evaluation order.
+ */
+static unsigned fimd_jit_boundary_order(int boundary[][2], unsigned boundary_num, int order[][2])
+{
+    unsigned quadrant_num = 0;
+    int radius = 0;
+    int (*quadrant)[2] = malloc(boundary_num * sizeof(*quadrant));
+    int* dists = malloc(boundary_num * sizeof(int));
+    if (!quadrant || !dists) {
+        free(quadrant);
+        free(dists);
+        return 0;
+    }
+
+    for (unsigned i = 0; i < boundary_num; i++) {
+        if (boundary[i][0] >= 0 && boundary[i][1] >= 0) {
+            quadrant[quadrant_num][0] = boundary[i][0];
+            quadrant[quadrant_num][1] = boundary[i][1];
+            quadrant_num++;
+        }
+        if (boundary[i][0] > radius) {
+            radius = boundary[i][0];
+        }
+    }
+    for (unsigned i = 0; i < quadrant_num; i++) {
+        int y = quadrant[i][0], x = radius - quadrant[i][1];
+        dists[i] = (y > x) ? y : x;
+    }
+
+    unsigned order_num = 0, i_next = 0;
+    while (order_num < boundary_num) {
+        int y = quadrant[i_next][0], x = quadrant[i_next][1];
+        order[order_num][0] = y; order[order_num][1] = x; order_num++;
+        order[order_num][0] = -y; order[order_num][1] = -x; order_num++;
+        if (x == 0) {
+            order[order_num][0] = 0; order[order_num][1] = y; order_num++;
+            order[order_num][0] = 0; order[order_num][1] = -y; order_num++;
+        } else {
+            order[order_num][0] = x; order[order_num][1] = -y; order_num++;
+            order[order_num][0] = -x; order[order_num][1] = y; order_num++;
+        }
+        dists[i_next] = 0;
+
+        // the most distant point from all points evaluated so far (the largest y for equal distances)
+        int sel_dist = 0, sel_y = 0;
+        unsigned sel_i = 0;
+        for (unsigned i = 0; i < quadrant_num; i++) {
+            int dy = abs(quadrant[i][0] - y), dx = abs(quadrant[i][1] - x);
+            int dist = (dy > dx) ? dy : dx;
+            if (dists[i] > dist) {
+                dists[i] = dist;
+            }
+            if (dists[i] > sel_dist || (dists[i] == sel_dist && quadrant[i][0] > sel_y)) {
+                sel_dist = dists[i];
+                sel_y = quadrant[i][0];
+                sel_i = i;
+            }
+        }
+        i_next = sel_i;
+    }
+
+    free(quadrant);
+    free(dists);
+    return order_num;
+}
+
+static int fimd_jit_compare_points(const void* a, const void* b)
+{
+    const int* pa = (const int*) a;
+    const int* pb = (const int*) b;
+    if (pa[0] != pb[0]) {
+        return (pa[0] < pb[0]) ? -1 : 1;
+    }
+    return (pa[1] < pb[1]) ? -1 : (pa[1] > pb[1]);
+}
+
+static void fimd_jit_u8(struct fimd_jit_code_s* code, uint8_t value)
+{
+    code->data[code->size++] = value;
+}
+
+static void fimd_jit_u16(struct fimd_jit_code_s* code, uint16_t value)
+{
+    fimd_jit_u8(code, (uint8_t) value);
+    fimd_jit_u8(code, (uint8_t) (value >> 8));
+}
+
+static void fimd_jit_u32(struct fimd_jit_code_s* code, uint32_t value)
+{
+    fimd_jit_u16(code, (uint16_t) value);
+    fimd_jit_u16(code, (uint16_t) (value >> 16));
+}
+
+static void fimd_jit_bytes(struct fimd_jit_code_s* code, const char* bytes, size_t count)
+{
+    memcpy(code->data + code->size, bytes, count);
+    code->size += count;
+}
+
+// jmp rel32 to a known target, returns the position of rel32
+static size_t fimd_jit_jmp(struct fimd_jit_code_s* code, size_t target)
+{
+    fimd_jit_u8(code, 0xE9);
+    fimd_jit_u32(code, (uint32_t) (target - (code->size + 4)));
+    return code->size - 4;
+}
+
+// jcc rel32 to a known target, returns the position of rel32
+static size_t fimd_jit_jcc(struct fimd_jit_code_s* code, uint8_t cc, size_t target)
+{
+    fimd_jit_u8(code, 0x0F);
+    fimd_jit_u8(code, cc);
+    fimd_jit_u32(code, (uint32_t) (target - (code->size + 4)));
+    return code->size - 4;
+}
+
+// sets the target of a forward jump
+static void fimd_jit_patch(struct fimd_jit_code_s* code, size_t rel_pos, size_t target)
+{
+    uint32_t rel = (uint32_t) (target - (rel_pos + 4));
+    memcpy(code->data + rel_pos, &rel, sizeof(rel));
+}
+
+// movzx r10d, byte [rdi + disp]
+static void fimd_jit_load_r10(struct fimd_jit_code_s* code, int32_t disp)
+{
+    fimd_jit_bytes(code, "\x44\x0F\xB6\x97", 4);
+    fimd_jit_u32(code, (uint32_t) disp);
+}
+
+// mov word [rdi + disp], FIMD_TERM_SEQ
+static void fimd_jit_add_term_seq(struct fimd_jit_code_s* code, int32_t offset)
+{
+    fimd_jit_bytes(code, "\x66\xC7\x87", 3);
+    fimd_jit_u32(code, (uint32_t) offset);
+    fimd_jit_u16(code, (uint16_t) FIMD_TERM_SEQ);
+}
+
+// VEX encoded instruction (map 1: 0F, map 2: 0F38), the operand rm is a register or the memory [rdi + disp]
+static void fimd_jit_vex(struct fimd_jit_code_s* code, uint8_t map, uint8_t prefix, uint8_t l, uint8_t opcode, uint8_t reg, uint8_t vvvv, uint8_t rm, int mem, int32_t disp)
+{
+    uint8_t pp = (prefix == 0x66) ? 1 : ((prefix == 0xF3) ? 2 : 0);
+    fimd_jit_u8(code, 0xC4);
+    fimd_jit_u8(code, (uint8_t) (((reg < 8) << 7) | (1 << 6) | ((mem || rm < 8) << 5) | map));
+    fimd_jit_u8(code, (uint8_t) (((~vvvv & 0xF) << 3) | (l << 2) | pp));
+    fimd_jit_u8(code, opcode);
+    if (mem) {
+        fimd_jit_u8(code, (uint8_t) (0x87 | ((reg & 7) << 3)));
+        fimd_jit_u32(code, (uint32_t) disp);
+    } else {
+        fimd_jit_u8(code, (uint8_t) (0xC0 | ((reg & 7) << 3) | (rm & 7)));
+    }
+}
+
+/*
+ * Vector instruction reg = op(reg, rm) with the registers xmm0-15 (SSE2) or ymm0-15 (AVX2, VEX encoded),
+ * or reg = op(rm) for the moves and pmovmskb (reg is then a general purpose register).
+ */
+static void fimd_jit_vec(struct fimd_jit_code_s* code, uint8_t prefix, uint8_t opcode, uint8_t reg, uint8_t rm)
+{
+    if (code->simd_width == 32) {
+        int unary = (opcode == 0x6F || opcode == 0xD7);
+        fimd_jit_vex(code, 1, prefix, 1, opcode, reg, unary ? 0 : reg, rm, 0, 0);
+        return;
+    }
+    fimd_jit_u8(code, prefix);
+    if (reg >= 8 || rm >= 8) {
+        fimd_jit_u8(code, (uint8_t) (0x40 | ((reg >= 8) << 2) | (rm >= 8)));
+    }
+    fimd_jit_u8(code, 0x0F);
+    fimd_jit_u8(code, opcode);
+    fimd_jit_u8(code, (uint8_t) (0xC0 | ((reg & 7) << 3) | (rm & 7)));
+}
+
+// Vector load of the memory [rdi + disp] (movdqu)
+static void fimd_jit_vec_load(struct fimd_jit_code_s* code, uint8_t reg, int32_t disp)
+{
+    if (code->simd_width == 32) {
+        fimd_jit_vex(code, 1, 0xF3, 1, 0x6F, reg, 0, 0, 1, disp);
+        return;
+    }
+    fimd_jit_u8(code, 0xF3);
+    if (reg >= 8) {
+        fimd_jit_u8(code, 0x44);
+    }
+    fimd_jit_u8(code, 0x0F);
+    fimd_jit_u8(code, 0x6F);
+    fimd_jit_u8(code, (uint8_t) (0x87 | ((reg & 7) << 3)));
+    fimd_jit_u32(code, (uint32_t) disp);
+}
+
+// broadcasts the byte into all lanes of the vector register (eax is overwritten)
+static void fimd_jit_broadcast(struct fimd_jit_code_s* code, uint8_t value, uint8_t reg)
+{
+    fimd_jit_u8(code, 0xB8); // mov eax, imm32
+    fimd_jit_u32(code, value * 0x01010101u);
+    if (code->simd_width == 32) {
+        fimd_jit_vex(code, 1, 0x66, 0, 0x6E, reg, 0, 0, 0, 0); // vmovd xmm, eax
+        fimd_jit_vex(code, 2, 0x66, 1, 0x58, reg, 0, reg, 0, 0); // vpbroadcastd ymm, xmm
+        return;
+    }
+    fimd_jit_vec(code, 0x66, 0x6E, reg, 0); // movd xmm, eax
+    fimd_jit_vec(code, 0x66, 0x70, reg, reg); // pshufd xmm, xmm, 0
+    fimd_jit_u8(code, 0x00);
+}
+
+static void fimd_jit_emit(struct fimd_jit_code_s* code, uint32_t stride, fimd_thresholds_t thresholds,
+                          int boundary[][2], unsigned boundary_num, int interior[][2], unsigned interior_num, int32_t offset, size_t* to_done)
+{
+#define FIMD_JIT_DISP(_pt) ((int32_t) ((_pt)[0] * (int32_t) stride + (_pt)[1]))
+
+    // prologue: push rbx; lea rsi, [rsi - (offset + simd_width)]; add rdi, offset - 1
+    fimd_jit_u8(code, 0x53);
+    fimd_jit_bytes(code, "\x48\x8D\xB6", 3);
+    fimd_jit_u32(code, (uint32_t) -(offset + (int32_t) code->simd_width));
+    fimd_jit_bytes(code, "\x48\x81\xC7", 3);
+    fimd_jit_u32(code, (uint32_t) (offset - 1));
+    fimd_jit_broadcast(code, thresholds.center, 5);
+    fimd_jit_broadcast(code, (uint8_t) ((FIMD_TERM_SEQ) & 0xFF), 6);
+    fimd_jit_broadcast(code, (uint8_t) (((FIMD_TERM_SEQ) >> 8) & 0xFF), 7);
+    fimd_jit_broadcast(code, thresholds.diff, 8);
+    fimd_jit_broadcast(code, (thresholds.sun > 0) ? (uint8_t) (thresholds.sun - 1) : 0, 9);
+    fimd_jit_vec(code, FIMD_JIT_PXOR, 4, 4);
+
+    // LOOP: skip ahead over the dark pixels (see fimd_simd_stop_mask())
+    size_t loop = code->size;
+    fimd_jit_bytes(code, "\x48\x39\xF7", 3); // cmp rdi, rsi
+    size_t to_scalar = fimd_jit_jcc(code, FIMD_JIT_JAE, loop);
+    fimd_jit_vec_load(code, 0, 1);
+    fimd_jit_vec(code, FIMD_JIT_MOVDQA, 1, 0);
+    fimd_jit_vec(code, FIMD_JIT_PSUBUSB, 1, 5);
+    fimd_jit_vec(code, FIMD_JIT_PCMPEQB, 1, 4); // xmm1: pixels not above threshold_center
+    fimd_jit_vec(code, FIMD_JIT_PMOVMSKB, 0, 1);
+    if (code->simd_width == 32) {
+        fimd_jit_bytes(code, "\xF7\xD0", 2); // not eax
+    } else {
+        fimd_jit_bytes(code, "\x35\xFF\xFF\x00\x00", 5); // xor eax, 0xFFFF
+    }
+    fimd_jit_vec_load(code, 2, offset);
+    fimd_jit_vec_load(code, 3, offset + 1);
+    fimd_jit_vec(code, FIMD_JIT_PCMPEQB, 2, 6);
+    fimd_jit_vec(code, FIMD_JIT_PCMPEQB, 3, 7);
+    fimd_jit_vec(code, FIMD_JIT_PAND, 2, 3);
+    fimd_jit_vec(code, FIMD_JIT_PMOVMSKB, 10, 2);
+    fimd_jit_bytes(code, "\x44\x09\xD0", 3); // or eax, r10d
+    fimd_jit_bytes(code, "\x75\x09", 2); // jnz BOUNDARY
+    fimd_jit_bytes(code, "\x48\x83\xC7", 3); // add rdi, simd_width
+    fimd_jit_u8(code, (uint8_t) code->simd_width);
+    fimd_jit_jmp(code, loop);
+
+    // BOUNDARY: the scalar code handles the full sun points limit
+    fimd_jit_bytes(code, "\x41\x81\x39", 3); // cmp dword [r9], FIMD_MAX_SUN_PTS_COUNT
+    fimd_jit_u32(code, FIMD_MAX_SUN_PTS_COUNT);
+    size_t to_found = fimd_jit_jcc(code, FIMD_JIT_JE, loop);
+    fimd_jit_vec(code, FIMD_JIT_PCMPEQB, 3, 3);
+    fimd_jit_vec(code, FIMD_JIT_PXOR, 1, 3); // xmm1: marker candidates (above threshold_center)
+    fimd_jit_vec(code, FIMD_JIT_MOVDQA, 2, 0);
+    fimd_jit_vec(code, FIMD_JIT_PSUBUSB, 2, 9);
+    fimd_jit_vec(code, FIMD_JIT_PCMPEQB, 2, 4);
+    fimd_jit_vec(code, FIMD_JIT_PANDN, 2, 1); // xmm2: sun candidates (also at least threshold_sun)
+    for (unsigned i = 0; i < boundary_num; i++) {
+        // xmm10: pixels whose difference from the boundary pixel is not above threshold_diff
+        fimd_jit_vec_load(code, 3, 1 + FIMD_JIT_DISP(boundary[i]));
+        fimd_jit_vec(code, FIMD_JIT_MOVDQA, 10, 0);
+        fimd_jit_vec(code, FIMD_JIT_PSUBUSB, 10, 3);
+        fimd_jit_vec(code, FIMD_JIT_PSUBUSB, 10, 8);
+        fimd_jit_vec(code, FIMD_JIT_PCMPEQB, 10, 4);
+        fimd_jit_vec(code, FIMD_JIT_PAND, 2, 10);
+        fimd_jit_vec(code, FIMD_JIT_PANDN, 10, 1);
+        fimd_jit_vec(code, FIMD_JIT_MOVDQA, 1, 10);
+        fimd_jit_vec(code, FIMD_JIT_MOVDQA, 3, 1);
+        fimd_jit_vec(code, FIMD_JIT_POR, 3, 2);
+        fimd_jit_vec(code, FIMD_JIT_PMOVMSKB, 0, 3);
+        fimd_jit_bytes(code, "\x85\xC0", 2); // test eax, eax
+        to_done[i] = fimd_jit_jcc(code, FIMD_JIT_JE, loop);
+    }
+    for (unsigned i = 0; i < boundary_num; i++) {
+        fimd_jit_patch(code, to_done[i], code->size);
+    }
+    // DONE: stop before the candidates or the termination sequence
+    fimd_jit_bytes(code, "\x44\x09\xD0", 3); // or eax, r10d
+    fimd_jit_bytes(code, "\x75\x09", 2); // jnz FOUND
+    fimd_jit_bytes(code, "\x48\x83\xC7", 3); // add rdi, simd_width
+    fimd_jit_u8(code, (uint8_t) code->simd_width);
+    fimd_jit_jmp(code, loop);
+    // FOUND: bsf eax, eax; add rdi, rax
+    fimd_jit_patch(code, to_found, code->size);
+    fimd_jit_bytes(code, "\x0F\xBC\xC0\x48\x01\xC7", 6);
+
+    // SCALAR: check for the presence of the termination sequence
+    fimd_jit_patch(code, to_scalar, code->size);
+    fimd_jit_bytes(code, "\x66\x81\xBF", 3); // cmp word [rdi + offset], FIMD_TERM_SEQ
+    fimd_jit_u32(code, (uint32_t) offset);
+    fimd_jit_u16(code, (uint16_t) FIMD_TERM_SEQ);
+    if (code->simd_width == 32) {
+        fimd_jit_bytes(code, "\x75\x08", 2); // jne CONTINUE
+        fimd_jit_bytes(code, "\xC5\xF8\x77", 3); // vzeroupper
+    } else {
+        fimd_jit_bytes(code, "\x75\x05", 2); // jne CONTINUE
+    }
+    fimd_jit_bytes(code, "\x48\x89\xF8\x5B\xC3", 5); // mov rax, rdi; pop rbx; ret
+
+    // CONTINUE: load new pixel value from pre-incremented address
+    fimd_jit_bytes(code, "\x48\xFF\xC7\x0F\xB6\x07", 6); // inc rdi; movzx eax, byte [rdi]
+    fimd_jit_u8(code, 0x3D); // cmp eax, threshold_center
+    fimd_jit_u32(code, thresholds.center);
+    fimd_jit_jcc(code, FIMD_JIT_JBE, loop);
+    fimd_jit_bytes(code, "\x44\x8D\x98", 3); // lea r11d, [rax - threshold_diff]
+    fimd_jit_u32(code, (uint32_t) -(int32_t) thresholds.diff);
+
+    // first boundary pixel test - decide between MARKER_TEST and SUN_TEST (pix_val - b > diff, i.e., b < r11d)
+    fimd_jit_load_r10(code, FIMD_JIT_DISP(boundary[0]));
+    fimd_jit_bytes(code, "\x45\x39\xDA", 3); // cmp r10d, r11d
+    size_t to_marker = fimd_jit_jcc(code, FIMD_JIT_JL, loop);
+    fimd_jit_u8(code, 0x3D); // cmp eax, threshold_sun
+    fimd_jit_u32(code, thresholds.sun);
+    fimd_jit_jcc(code, FIMD_JIT_JB, loop);
+
+    // SUN_TEST: check the current number of the detected sun points
+    fimd_jit_bytes(code, "\x41\x81\x39", 3); // cmp dword [r9], FIMD_MAX_SUN_PTS_COUNT
+    fimd_jit_u32(code, FIMD_MAX_SUN_PTS_COUNT);
+    fimd_jit_bytes(code, "\x75\x0E", 2); // jne SUN_BOUNDARY
+    fimd_jit_add_term_seq(code, offset);
+    fimd_jit_jmp(code, loop);
+    for (unsigned i = 1; i < boundary_num; i++) {
+        fimd_jit_load_r10(code, FIMD_JIT_DISP(boundary[i]));
+        fimd_jit_bytes(code, "\x45\x39\xDA", 3); // cmp r10d, r11d
+        fimd_jit_jcc(code, FIMD_JIT_JL, loop);
+    }
+    for (unsigned i = 0; i < interior_num; i++) {
+        fimd_jit_bytes(code, "\xC6\x87", 2); // mov byte [rdi + disp], 0
+        fimd_jit_u32(code, (uint32_t) FIMD_JIT_DISP(interior[i]));
+        fimd_jit_u8(code, 0x00);
+    }
+    // store current pixel address as sun detection
+    fimd_jit_bytes(code, "\x45\x8B\x11", 3); // mov r10d, [r9]
+    fimd_jit_bytes(code, "\x4B\x89\x3C\xD0", 4); // mov [r8 + r10*8], rdi
+    fimd_jit_bytes(code, "\x41\xFF\xC2", 3); // inc r10d
+    fimd_jit_bytes(code, "\x45\x89\x11", 3); // mov [r9], r10d
+    fimd_jit_jmp(code, loop);
+
+    // MARKER_TEST
+    fimd_jit_patch(code, to_marker, code->size);
+    for (unsigned i = 1; i < boundary_num; i++) {
+        fimd_jit_load_r10(code, FIMD_JIT_DISP(boundary[i]));
+        fimd_jit_bytes(code, "\x45\x39\xDA", 3); // cmp r10d, r11d
+        fimd_jit_jcc(code, FIMD_JIT_JGE, loop);
+    }
+    // marker potential preserved, search for peak in interior (eax: peak, r11: peak_ptr)
+    fimd_jit_bytes(code, "\x31\xC0\x45\x31\xDB", 5); // xor eax, eax; xor r11d, r11d
+    for (unsigned i = 0; i < interior_num; i++) {
+        int32_t disp = FIMD_JIT_DISP(interior[i]);
+        fimd_jit_load_r10(code, disp);
+        fimd_jit_bytes(code, "\x48\x8D\x9F", 3); // lea rbx, [rdi + disp]
+        fimd_jit_u32(code, (uint32_t) disp);
+        fimd_jit_bytes(code, "\x41\x39\xC2", 3); // cmp r10d, eax
+        fimd_jit_bytes(code, "\x41\x0F\x47\xC2", 4); // cmova eax, r10d
+        fimd_jit_bytes(code, "\x4C\x0F\x47\xDB", 4); // cmova r11, rbx
+        fimd_jit_bytes(code, "\xC6\x87", 2); // mov byte [rdi + disp], 0
+        fimd_jit_u32(code, (uint32_t) disp);
+        fimd_jit_u8(code, 0x00);
+    }
+    // store peak address as marker detection
+    fimd_jit_bytes(code, "\x44\x8B\x11", 3); // mov r10d, [rcx]
+    fimd_jit_bytes(code, "\x4E\x89\x1C\xD2", 4); // mov [rdx + r10*8], r11
+    fimd_jit_bytes(code, "\x41\xFF\xC2", 3); // inc r10d
+    fimd_jit_bytes(code, "\x44\x89\x11", 3); // mov [rcx], r10d
+    fimd_jit_bytes(code, "\x41\x81\xFA", 3); // cmp r10d, FIMD_MAX_MARKERS_COUNT
+    fimd_jit_u32(code, FIMD_MAX_MARKERS_COUNT);
+    fimd_jit_jcc(code, FIMD_JIT_JNE, loop);
+    fimd_jit_add_term_seq(code, offset);
+    fimd_jit_jmp(code, loop);
+#undef FIMD_JIT_DISP
+}
+
+static struct fimd_jit_entry_s* fimd_jit_create(unsigned radius, uint32_t stride, fimd_thresholds_t thresholds, unsigned simd_width)
+{
+    unsigned boundary_num, order_num, interior_num, front_num = 0;
+    size_t pts_max = 8 * ((size_t) radius + 1) * ((size_t) radius + 1);
+    int (*boundary)[2] = malloc((8 * ((size_t) radius + 1)) * sizeof(*boundary));
+    int (*order)[2] = malloc((8 * ((size_t) radius + 1) + 4) * sizeof(*order));
+    int (*interior)[2] = malloc(pts_max * sizeof(*interior));
+    size_t* patches = malloc((8 * ((size_t) radius + 1) + 4) * sizeof(size_t));
+    struct fimd_jit_entry_s* entry = malloc(sizeof(struct fimd_jit_entry_s));
+    if (!boundary || !order || !interior || !patches || !entry) {
+        goto FAIL;
+    }
+
+    // boundary in the evaluation order, interior pixels after the central pixel in the memory order
+    fimd_jit_circle_points((int) radius, boundary, &boundary_num, interior, &interior_num);
+    order_num = fimd_jit_boundary_order(boundary, boundary_num, order);
+    if (order_num == 0) {
+        goto FAIL;
+    }
+    for (unsigned i = 0; i < interior_num; i++) {
+        if (interior[i][0] > 0 || (interior[i][0] == 0 && interior[i][1] >= 0)) {
+            interior[front_num][0] = interior[i][0];
+            interior[front_num][1] = interior[i][1];
+            front_num++;
+        }
+    }
+    qsort(interior, front_num, sizeof(*interior), fimd_jit_compare_points);
+
+    struct fimd_jit_code_s code;
+    size_t capacity = FIMD_JIT_CODE_FIXED + FIMD_JIT_CODE_BOUNDARY * (size_t) order_num + FIMD_JIT_CODE_INTERIOR * (size_t) front_num;
+    code.data = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    code.size = 0;
+    code.simd_width = simd_width;
+    if (code.data == MAP_FAILED) {
+        goto FAIL;
+    }
+    fimd_jit_emit(&code, stride, thresholds, order, order_num, interior, front_num, (int32_t) (stride * radius + radius), patches);
+    if (mprotect(code.data, capacity, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code.data, capacity);
+        goto FAIL;
+    }
+
+    entry->radius = radius;
+    entry->stride = stride;
+    entry->thresholds = thresholds;
+    entry->simd_width = simd_width;
+    entry->code = code.data;
+    entry->code_size = capacity;
+    // conversion of the object pointer to the function pointer (POSIX, not ISO C)
+    memcpy(&entry->kernel, &entry->code, sizeof(entry->kernel));
+    entry->users = 0;
+    entry->next = NULL;
+
+    free(boundary);
+    free(order);
+    free(interior);
+    free(patches);
+    return entry;
+
+FAIL:
+    free(boundary);
+    free(order);
+    free(interior);
+    free(patches);
+    free(entry);
+    return NULL;
+}
+
+fimd_kernel_t fimd_jit_get_kernel(unsigned radius, uint32_t stride, fimd_thresholds_t thresholds, unsigned simd_width)
+{
+    if ((simd_width != 16 && simd_width != 32) || radius < 1 || radius > FIMD_JIT_MAX_RADIUS || (uint64_t) stride * radius + radius > (uint64_t) INT32_MAX / 2) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&fimd_jit_lock);
+    struct fimd_jit_entry_s** link = &fimd_jit_cache;
+    while (*link && !((*link)->radius == radius && (*link)->stride == stride && (*link)->thresholds.center == thresholds.center
+                      && (*link)->thresholds.diff == thresholds.diff && (*link)->thresholds.sun == thresholds.sun
+                      && (*link)->simd_width == simd_width)) {
+        link = &(*link)->next;
+    }
+    struct fimd_jit_entry_s* entry = *link;
+    if (entry) {
+        // the most recently used kernel moves to the front
+        *link = entry->next;
+    } else {
+        entry = fimd_jit_create(radius, stride, thresholds, simd_width);
+        fimd_jit_cache_count += (entry) ? 1 : 0;
+    }
+    if (entry) {
+        entry->users++;
+        entry->next = fimd_jit_cache;
+        fimd_jit_cache = entry;
+    }
+
+    // release the least recently used kernels above the limit, the kernels in use are kept
+    while (fimd_jit_cache_count > FIMD_JIT_CACHE_MAX_ENTRIES) {
+        struct fimd_jit_entry_s** unused = NULL;
+        for (link = &fimd_jit_cache; *link; link = &(*link)->next) {
+            if ((*link)->users == 0) {
+                unused = link;
+            }
+        }
+        if (!unused) {
+            break;
+        }
+        struct fimd_jit_entry_s* evicted = *unused;
+        *unused = evicted->next;
+        munmap(evicted->code, evicted->code_size);
+        free(evicted);
+        fimd_jit_cache_count--;
+    }
+    pthread_mutex_unlock(&fimd_jit_lock);
+
+    return (entry) ? entry->kernel : NULL;
+}
+
+void fimd_jit_release_kernel(fimd_kernel_t kernel)
+{
+    pthread_mutex_lock(&fimd_jit_lock);
+    for (struct fimd_jit_entry_s* entry = fimd_jit_cache; entry; entry = entry->next) {
+        if (entry->kernel == kernel) {
+            entry->users -= (entry->users > 0) ? 1 : 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fimd_jit_lock);
+}
+
+void fimd_jit_clear()
+{
+    pthread_mutex_lock(&fimd_jit_lock);
+    while (fimd_jit_cache) {
+        struct fimd_jit_entry_s* entry = fimd_jit_cache;
+        fimd_jit_cache = entry->next;
+        munmap(entry->code, entry->code_size);
+        free(entry);
+    }
+    fimd_jit_cache_count = 0;
+    pthread_mutex_unlock(&fimd_jit_lock);
+}
@@ -0,0 +1,53 @@
+/**
+ * \file fimd_jit.h
+ * \author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \date December 2024
+ * \brief Internal header file for the runtime emitter of the FIMD-CPU kernels (x86-64).
+ * \copyright GNU Public License.
+ */
+
+#ifndef FIMD_JIT_H
+#define FIMD_JIT_H
+
+#include <stdint.h>
+
+#include "fimd_kernels.h"
+#include "fimd_thresholds.h"
+
+// Largest radius of the emitted kernels (the code size grows with the number of interior pixels)
+#define FIMD_JIT_MAX_RADIUS 255
+
+// Number of the cached kernels, above which the least recently used kernels are released (unless they are in use)
+#define FIMD_JIT_CACHE_MAX_ENTRIES 32
+
+/**
+ * \brief Gets a kernel emitted at runtime for the given radius, row pitch and thresholds.
+ *
+ * The kernel has the same interface and output as the generated kernel fimd_r{radius}_w{stride}, but the boundary
+ * and interior offsets, the thresholds and the limits are immediates of the emitted code. The kernels are cached
+ * by the parameters, so only the first call for each combination emits the code. The kernel is in use until it is
+ * passed to fimd_jit_release_kernel(). When the cache holds more than FIMD_JIT_CACHE_MAX_ENTRIES kernels, the least
+ * recently used kernels which are not in use are released.
+ *
+ * \param radius Radius of the circle (1 to FIMD_JIT_MAX_RADIUS).
+ * \param stride Row pitch of the image in bytes.
+ * \param thresholds Thresholds of the detection.
+ * \param simd_width Pixels per block of the skip-ahead loop: 16 (SSE2) or 32 (AVX2, the CPU must support it).
+ * \return Pointer to the kernel, or NULL on invalid parameters or memory allocation error.
+ */
+fimd_kernel_t fimd_jit_get_kernel(unsigned radius, uint32_t stride, fimd_thresholds_t thresholds, unsigned simd_width);
+
+/**
+ * \brief Ends the use of a kernel returned by fimd_jit_get_kernel() (other kernels are ignored).
+ *
+ * \param kernel Pointer to the kernel, not called afterwards.
+ */
+void fimd_jit_release_kernel(fimd_kernel_t kernel);
+
+/**
+ * \brief Releases all cached kernels (no kernel may be running or used afterwards).
+ */
+void fimd_jit_clear();
+
+
+#endif //FIMD_JIT_H
@@ -0,0 +1,43 @@
+/**
+ * \file fimd_kernels.h
+ * \author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \date December 2024
+ * \brief Internal header file with the sets of the generated FIMD-CPU kernels (one set per row pitch).
+ * \copyright GNU Public License.
+ */
+
+#ifndef FIMD_KERNELS_H
+#define FIMD_KERNELS_H
+
+#include <stdint.h>
+
+#include "fimd_scan.h"
+#include "fimd_thresholds.h"
+
+// Pointer to the generated kernel for a single radius
+typedef uint8_t* (*fimd_kernel_t)(uint8_t* img_ptr, uint8_t* img_end, uintptr_t* markers, uint32_t* markers_num, uintptr_t* sun_pts, uint32_t* sun_pts_num);
+
+// Pointer to the generated kernel for a single radius with 16-bit pixels (the offsets and the row pitch are in pixels)
+typedef uint16_t* (*fimd_kernel16_t)(uint16_t* img_ptr, uint16_t* img_end, const fimd_thresholds16_t* thresholds, uintptr_t* markers, uint32_t* markers_num, uintptr_t* sun_pts, uint32_t* sun_pts_num);
+
+// Pointer to the generated fused kernel for all radii
+typedef uint8_t* (*fimd_fused_kernel_t)(uint8_t* img_ptr, uint8_t* img_end, uintptr_t* markers, uint8_t* markers_radii, uint32_t* markers_num, uintptr_t* sun_pts, uint8_t* sun_pts_radii, uint32_t* sun_pts_num);
+
+/**
+ * \brief Generated kernels for a single row pitch, compiled for a single instruction set.
+ *
+ * The boundary and interior offsets are constants in all kernels, hence each row pitch has its own set
+ * (see template_kernels.c). The kernels for the radius radii[i] are stored at the index i.
+ */
+typedef struct fimd_kernel_set_s {
+    uint32_t stride;
+    uint32_t radii[FIMD_RADII_COUNT];
+    fimd_kernel_t kernels[FIMD_RADII_COUNT];
+    fimd_fused_kernel_t fused;
+    fimd_scan_kernel_t bounded[FIMD_RADII_COUNT];
+    // kernels with 16-bit pixels (NULL if not compiled, see FIMD_PIXELS_16 in CMakeLists.txt)
+    fimd_kernel16_t kernels16[FIMD_RADII_COUNT];
+} fimd_kernel_set_t;
+
+
+#endif //FIMD_KERNELS_H
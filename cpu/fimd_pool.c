@@ -0,0 +1,166 @@
+/**
+ * \file fimd_pool.c
+ * \author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \date December 2024
+ * \brief Source file for a minimal persistent thread pool used by the FIMD-CPU library.
+ * \copyright GNU Public License.
+ */
+
+// POSIX threads are not a part of C99
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "fimd_pool.h"
+
+struct fimd_pool_worker_s {
+    struct fimd_pool_s* pool;
+    unsigned index;
+    pthread_t thread;
+};
+
+struct fimd_pool_s {
+    pthread_mutex_t lock;
+    pthread_cond_t cond_start;
+    pthread_cond_t cond_done;
+
+    // current job (protected by the lock)
+    fimd_pool_task_t task;
+    void* arg;
+    unsigned tasks_count;
+    unsigned tasks_next;
+    unsigned tasks_done;
+    unsigned long generation;
+    int stop;
+
+    unsigned threads_count;
+    unsigned workers_started;
+    struct fimd_pool_worker_s* workers;
+};
+
+
+static void fimd_pool_execute(struct fimd_pool_s* pool, unsigned worker_index)
+{
+    // called with the lock held, returns with the lock held
+    while (pool->tasks_next < pool->tasks_count) {
+        unsigned task_index = pool->tasks_next++;
+        fimd_pool_task_t task = pool->task;
+        void* arg = pool->arg;
+
+        pthread_mutex_unlock(&pool->lock);
+        task(arg, task_index, worker_index);
+        pthread_mutex_lock(&pool->lock);
+
+        if (++pool->tasks_done == pool->tasks_count) {
+            pthread_cond_broadcast(&pool->cond_done);
+        }
+    }
+}
+
+static void* fimd_pool_worker(void* data)
+{
+    struct fimd_pool_worker_s* worker = (struct fimd_pool_worker_s*) data;
+    struct fimd_pool_s* pool = worker->pool;
+    unsigned long generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (!pool->stop && pool->generation == generation) {
+            pthread_cond_wait(&pool->cond_start, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+        generation = pool->generation;
+        fimd_pool_execute(pool, worker->index);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+fimd_pool_t* fimd_pool_create(unsigned threads_count)
+{
+    if (threads_count == 0) {
+        threads_count = 1;
+    }
+
+    struct fimd_pool_s* pool = (struct fimd_pool_s*) calloc(1, sizeof(struct fimd_pool_s));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->threads_count = threads_count;
+    pool->workers = (struct fimd_pool_worker_s*) calloc(threads_count, sizeof(struct fimd_pool_worker_s));
+    if (!pool->workers) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond_start, NULL);
+    pthread_cond_init(&pool->cond_done, NULL);
+
+    // worker 0 is the calling thread of fimd_pool_run()
+    for (unsigned i = 1; i < threads_count; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        if (pthread_create(&pool->workers[i].thread, NULL, fimd_pool_worker, &pool->workers[i]) != 0) {
+            fimd_pool_destroy(pool);
+            return NULL;
+        }
+        pool->workers_started = i;
+    }
+
+    return pool;
+}
+
+unsigned fimd_pool_threads_count(const fimd_pool_t* pool)
+{
+    return pool->threads_count;
+}
+
+void fimd_pool_run(fimd_pool_t* pool, fimd_pool_task_t task, void* arg, unsigned tasks_count)
+{
+    if (tasks_count == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->tasks_count = tasks_count;
+    pool->tasks_next = 0;
+    pool->tasks_done = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->cond_start);
+
+    fimd_pool_execute(pool, 0);
+    while (pool->tasks_done < pool->tasks_count) {
+        pthread_cond_wait(&pool->cond_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void fimd_pool_destroy(fimd_pool_t* pool)
+{
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->cond_start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 1; i <= pool->workers_started; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&pool->cond_done);
+    pthread_cond_destroy(&pool->cond_start);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
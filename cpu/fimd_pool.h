@@ -0,0 +1,62 @@
+/**
+ * \file fimd_pool.h
+ * \author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \date December 2024
+ * \brief Header file for a minimal persistent thread pool used by the FIMD-CPU library.
+ * \copyright GNU Public License.
+ */
+
+#ifndef FIMD_POOL_H
+#define FIMD_POOL_H
+
+/**
+ * \brief Task function executed by the thread pool.
+ *
+ * \param arg User argument passed to fimd_pool_run().
+ * \param task_index Index of the task (0 to tasks_count-1).
+ * \param worker_index Index of the worker executing the task (0 to threads_count-1, 0 is the calling thread).
+ */
+typedef void (*fimd_pool_task_t)(void* arg, unsigned task_index, unsigned worker_index);
+
+/**
+ * \brief Opaque thread pool instance.
+ */
+typedef struct fimd_pool_s fimd_pool_t;
+
+/**
+ * \brief Creates a thread pool with persistent worker threads.
+ *
+ * \param threads_count Total number of threads including the calling thread (threads_count-1 workers are spawned).
+ * \return Pointer to the new thread pool, or NULL on failure.
+ */
+fimd_pool_t* fimd_pool_create(unsigned threads_count);
+
+/**
+ * \brief Gets the total number of threads of the pool (including the calling thread).
+ *
+ * \param pool Pointer to the thread pool.
+ * \return The number of threads.
+ */
+unsigned fimd_pool_threads_count(const fimd_pool_t* pool);
+
+/**
+ * \brief Runs the given number of tasks on the pool and waits for their completion.
+ *
+ * Tasks are distributed dynamically, the calling thread participates as the worker 0.
+ *
+ * \param pool Pointer to the thread pool.
+ * \param task Task function.
+ * \param arg User argument passed to the task function.
+ * \param tasks_count Number of tasks to execute.
+ */
+void fimd_pool_run(fimd_pool_t* pool, fimd_pool_task_t task, void* arg, unsigned tasks_count);
+
+/**
+ * \brief Stops all worker threads and destroys the thread pool.
+ *
+ * \param pool Pointer to the thread pool (may be NULL).
+ */
+void fimd_pool_destroy(fimd_pool_t* pool);
+
+
+#endif //FIMD_POOL_H
@@ -0,0 +1,99 @@
+/**
+ * \file fimd_scan.h
+ * \author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \date December 2024
+ * \brief Internal header file with the scan state of the bounded FIMD-CPU kernels (read-only input, no termination sequence).
+ * \copyright GNU Public License.
+ */
+
+#ifndef FIMD_SCAN_H
+#define FIMD_SCAN_H
+
+#include <stdint.h>
+
+#include "fimd_cpu.h"
+
+/**
+ * \brief State of a single scan of the bounded kernels.
+ *
+ * The bounded kernels test the central pixels in the range [begin, end) and never write into the image.
+ * Instead of zeroing the interior pixels of the detections, the kernels set their bits in the suppression bitmap
+ * and all suppressed pixels are then read as zero. The scan ends at the end pointer or when a limit
+ * on the number of detections is reached.
+ */
+typedef struct fimd_scan_s {
+    // image origin, i.e., the address of the pixel (0, 0)
+    const uint8_t* img;
+    // range of the central pixels [begin, end) to test (all boundary pixels of the range must be readable)
+    const uint8_t* begin;
+    const uint8_t* end;
+    // end of the readable memory (limits the vector loads)
+    const uint8_t* read_end;
+
+    // bitmap of the suppressed pixels (bit i corresponds to the pixel img[i])
+    uint8_t* suppressed;
+    // range of the pixel indices [suppressed_begin, suppressed_end) which may be suppressed (no pixel if equal)
+    uintptr_t suppressed_begin;
+    uintptr_t suppressed_end;
+
+    // coordinates of the detections and their limits
+    fimd_cpu_point_t* markers;
+    // centroids of the markers (the same indices as markers), NULL if not requested
+    fimd_cpu_centroid_t* centroids;
+    uint32_t markers_num;
+    uint32_t markers_max;
+    fimd_cpu_point_t* sun_pts;
+    uint32_t sun_pts_num;
+    uint32_t sun_pts_max;
+} fimd_scan_t;
+
+/**
+ * \brief Pointer to a bounded kernel for a single radius.
+ *
+ * \param scan Pointer to the scan state (the numbers of detections are updated).
+ * \return The address of the last tested central pixel if a limit was reached, the end pointer otherwise.
+ */
+typedef const uint8_t* (*fimd_scan_kernel_t)(fimd_scan_t* scan);
+
+// Size of the suppression bitmap in bytes for the given number of pixels
+#define FIMD_SCAN_BITMAP_SIZE(_pixels) (((_pixels) + 7) / 8)
+
+// Padding after the suppression bitmap for the vector loads of its bits (see fimd_simd_load_bits())
+#define FIMD_SCAN_BITMAP_PADDING 16
+
+// Checks the suppression bit of the pixel with the given index
+#define FIMD_SCAN_IS_SUPPRESSED(_bitmap, _index) (((_bitmap)[(_index) >> 3] >> ((_index) & 7)) & 1)
+
+// Sets the suppression bit of the pixel with the given index
+#define FIMD_SCAN_SUPPRESS(_bitmap, _index) ((_bitmap)[(_index) >> 3] |= (uint8_t) (1 << ((_index) & 7)))
+
+
+/**
+ * \brief Stores the peak and the centroid of a marker from the sums accumulated over its interior.
+ *
+ * \param centroid Pointer to the output centroid.
+ * \param peak_x Column of the peak.
+ * \param peak_y Row of the peak.
+ * \param center_x Column of the central pixel.
+ * \param center_y Row of the central pixel.
+ * \param weight Sum of the interior pixel values (positive, the central pixel is a part of the interior).
+ * \param sum_x Sum of the interior pixel values multiplied by their column offsets from the central pixel.
+ * \param sum_y Sum of the interior pixel values multiplied by their row offsets from the central pixel.
+ */
+static inline void fimd_scan_store_centroid(fimd_cpu_centroid_t* centroid, int32_t peak_x, int32_t peak_y, int32_t center_x, int32_t center_y,
+                                            uint32_t weight, int32_t sum_x, int32_t sum_y)
+{
+    // rounded to the nearest fixed point value (the offsets may be negative)
+    int64_t half = weight / 2;
+    int64_t dx = ((int64_t) sum_x * (1 << FIMD_CPU_CENTROID_FRAC_BITS) + ((sum_x < 0) ? -half : half)) / weight;
+    int64_t dy = ((int64_t) sum_y * (1 << FIMD_CPU_CENTROID_FRAC_BITS) + ((sum_y < 0) ? -half : half)) / weight;
+    int64_t cx = ((int64_t) center_x << FIMD_CPU_CENTROID_FRAC_BITS) + dx;
+    int64_t cy = ((int64_t) center_y << FIMD_CPU_CENTROID_FRAC_BITS) + dy;
+    centroid->x = (uint16_t) peak_x;
+    centroid->y = (uint16_t) peak_y;
+    centroid->cx = (cx > 0) ? (uint32_t) cx : 0;
+    centroid->cy = (cy > 0) ? (uint32_t) cy : 0;
+    centroid->weight = weight;
+}
+
+#endif //FIMD_SCAN_H
@@ -0,0 +1,309 @@
+/**
+ * \file fimd_simd.h
+ * \author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \date December 2024
+ * \brief Vector helpers for the generated FIMD-CPU kernels (skip-ahead scan, boundary test, instruction set variants).
+ * \copyright GNU Public License.
+ */
+
+#ifndef FIMD_SIMD_H
+#define FIMD_SIMD_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Bytes of the termination sequence as stored in the memory (little-endian)
+#define FIMD_TERM_SEQ_LO ((char) ((FIMD_TERM_SEQ) & 0xFF))
+#define FIMD_TERM_SEQ_HI ((char) (((FIMD_TERM_SEQ) >> 8) & 0xFF))
+
+// Termination sequence of the kernels with 16-bit pixels, each byte of FIMD_TERM_SEQ widened to a pixel (e.g., 0xFFFF, 0x0000)
+#define FIMD_TERM_SEQ16_LO ((uint16_t) (((FIMD_TERM_SEQ) & 0xFF) * 0x0101))
+#define FIMD_TERM_SEQ16_HI ((uint16_t) ((((FIMD_TERM_SEQ) >> 8) & 0xFF) * 0x0101))
+#define FIMD_TERM_SEQ16 ((uint32_t) FIMD_TERM_SEQ16_LO | ((uint32_t) FIMD_TERM_SEQ16_HI << 16))
+
+// Name of a generated kernel, suffixed by the instruction set variant if FIMD_ISA_SUFFIX is defined
+#ifdef FIMD_ISA_SUFFIX
+#define FIMD_KERNEL_NAME(_name) FIMD_KERNEL_NAME_SUFFIX(_name, FIMD_ISA_SUFFIX)
+#define FIMD_KERNEL_NAME_SUFFIX(_name, _suffix) FIMD_KERNEL_NAME_CAT(_name, _suffix)
+#define FIMD_KERNEL_NAME_CAT(_name, _suffix) _name ## _ ## _suffix
+#else
+#define FIMD_KERNEL_NAME(_name) _name
+#endif
+
+/*
+ * Each instruction set provides a vector of FIMD_SIMD_WIDTH pixels (fimd_simd_vec_t) and a bit mask
+ * with one bit per pixel (fimd_simd_mask_t, bit i corresponds to the pixel i of the vector):
+ * - fimd_simd_load(ptr) loads FIMD_SIMD_WIDTH pixels from an unaligned address,
+ * - fimd_simd_gt_mask(vec, threshold) sets the bits of the pixels above the threshold,
+ * - fimd_simd_diff_gt_mask(vec_a, vec_b, threshold) sets the bits of the pixels whose difference vec_a[i] - vec_b[i] is above the threshold,
+ * - fimd_simd_term_mask(ptr) sets the bits of the positions where the termination sequence ptr[i], ptr[i+1] is present,
+ * - fimd_simd_zero_masked(vec, mask) sets the pixels with the bit set in the mask to zero,
+ * - fimd_simd_and(vec_a, vec_b) and fimd_simd_max(vec_a, vec_b) compute the bitwise and and the maximum of the pixels.
+ * The kernels with 16-bit pixels use only fimd_simd_stop_mask16() over blocks of FIMD_SIMD_WIDTH16 pixels,
+ * the index of the first set pixel of its mask is FIMD_SIMD_CTZ16(mask).
+ */
+
+#if !defined(FIMD_NO_SIMD) && defined(__AVX512BW__)
+
+#include <immintrin.h>
+
+#define FIMD_SIMD_NAME "avx512"
+#define FIMD_SIMD_WIDTH 64
+#define FIMD_SIMD_CTZ(_mask) __builtin_ctzll(_mask)
+typedef uint64_t fimd_simd_mask_t;
+typedef __m512i fimd_simd_vec_t;
+
+static inline fimd_simd_vec_t fimd_simd_load(const uint8_t* ptr)
+{
+    return _mm512_loadu_si512((const void*) ptr);
+}
+
+static inline fimd_simd_mask_t fimd_simd_gt_mask(fimd_simd_vec_t vec, uint8_t threshold)
+{
+    return (fimd_simd_mask_t) _mm512_cmpgt_epu8_mask(vec, _mm512_set1_epi8((char) threshold));
+}
+
+static inline fimd_simd_mask_t fimd_simd_diff_gt_mask(fimd_simd_vec_t vec_a, fimd_simd_vec_t vec_b, uint8_t threshold)
+{
+    return fimd_simd_gt_mask(_mm512_subs_epu8(vec_a, vec_b), threshold);
+}
+
+static inline fimd_simd_mask_t fimd_simd_term_mask(const uint8_t* ptr)
+{
+    return (fimd_simd_mask_t) (_mm512_cmpeq_epi8_mask(fimd_simd_load(ptr), _mm512_set1_epi8(FIMD_TERM_SEQ_LO))
+                             & _mm512_cmpeq_epi8_mask(fimd_simd_load(ptr + 1), _mm512_set1_epi8(FIMD_TERM_SEQ_HI)));
+}
+
+static inline fimd_simd_vec_t fimd_simd_zero_masked(fimd_simd_vec_t vec, fimd_simd_mask_t mask)
+{
+    return _mm512_maskz_mov_epi8(~mask, vec);
+}
+
+static inline fimd_simd_vec_t fimd_simd_and(fimd_simd_vec_t vec_a, fimd_simd_vec_t vec_b)
+{
+    return _mm512_and_si512(vec_a, vec_b);
+}
+
+static inline fimd_simd_vec_t fimd_simd_max(fimd_simd_vec_t vec_a, fimd_simd_vec_t vec_b)
+{
+    return _mm512_max_epu8(vec_a, vec_b);
+}
+
+#define FIMD_SIMD_WIDTH16 32
+#define FIMD_SIMD_CTZ16(_mask) __builtin_ctzll(_mask)
+
+static inline fimd_simd_mask_t fimd_simd_stop_mask16(const uint16_t* pix_ptr, const uint16_t* term_ptr, uint16_t threshold)
+{
+    __m512i pix = _mm512_loadu_si512((const void*) pix_ptr);
+    __mmask32 term = _mm512_cmpeq_epi16_mask(_mm512_loadu_si512((const void*) term_ptr), _mm512_set1_epi16((short) FIMD_TERM_SEQ16_LO))
+                   & _mm512_cmpeq_epi16_mask(_mm512_loadu_si512((const void*) (term_ptr + 1)), _mm512_set1_epi16((short) FIMD_TERM_SEQ16_HI));
+    return (fimd_simd_mask_t) (_mm512_cmpgt_epu16_mask(pix, _mm512_set1_epi16((short) threshold)) | term);
+}
+
+#elif !defined(FIMD_NO_SIMD) && defined(__AVX2__)
+
+#include <immintrin.h>
+
+#define FIMD_SIMD_NAME "avx2"
+#define FIMD_SIMD_WIDTH 32
+#define FIMD_SIMD_CTZ(_mask) __builtin_ctz(_mask)
+typedef uint32_t fimd_simd_mask_t;
+typedef __m256i fimd_simd_vec_t;
+
+static inline fimd_simd_vec_t fimd_simd_load(const uint8_t* ptr)
+{
+    return _mm256_loadu_si256((const __m256i*) ptr);
+}
+
+static inline fimd_simd_mask_t fimd_simd_gt_mask(fimd_simd_vec_t vec, uint8_t threshold)
+{
+    // unsigned comparison: saturated subtraction of the threshold is zero for the pixels not above it
+    __m256i not_above = _mm256_cmpeq_epi8(_mm256_subs_epu8(vec, _mm256_set1_epi8((char) threshold)), _mm256_setzero_si256());
+    return ~((fimd_simd_mask_t) _mm256_movemask_epi8(not_above));
+}
+
+static inline fimd_simd_mask_t fimd_simd_diff_gt_mask(fimd_simd_vec_t vec_a, fimd_simd_vec_t vec_b, uint8_t threshold)
+{
+    return fimd_simd_gt_mask(_mm256_subs_epu8(vec_a, vec_b), threshold);
+}
+
+static inline fimd_simd_mask_t fimd_simd_term_mask(const uint8_t* ptr)
+{
+    __m256i term = _mm256_and_si256(
+        _mm256_cmpeq_epi8(fimd_simd_load(ptr), _mm256_set1_epi8(FIMD_TERM_SEQ_LO)),
+        _mm256_cmpeq_epi8(fimd_simd_load(ptr + 1), _mm256_set1_epi8(FIMD_TERM_SEQ_HI))
+    );
+    return (fimd_simd_mask_t) _mm256_movemask_epi8(term);
+}
+
+static inline fimd_simd_vec_t fimd_simd_zero_masked(fimd_simd_vec_t vec, fimd_simd_mask_t mask)
+{
+    // byte i of each 64-bit part of the selector tests the bit i of the mask byte broadcast into the pixel
+    const __m256i selector = _mm256_set1_epi64x(0x8040201008040201LL);
+    __m256i bytes = _mm256_shuffle_epi8(_mm256_set1_epi32((int) mask), _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3));
+    __m256i zeroed = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, selector), selector);
+    return _mm256_andnot_si256(zeroed, vec);
+}
+
+static inline fimd_simd_vec_t fimd_simd_and(fimd_simd_vec_t vec_a, fimd_simd_vec_t vec_b)
+{
+    return _mm256_and_si256(vec_a, vec_b);
+}
+
+static inline fimd_simd_vec_t fimd_simd_max(fimd_simd_vec_t vec_a, fimd_simd_vec_t vec_b)
+{
+    return _mm256_max_epu8(vec_a, vec_b);
+}
+
+// two mask bits per 16-bit pixel (byte mask of the comparison results)
+#define FIMD_SIMD_WIDTH16 16
+#define FIMD_SIMD_CTZ16(_mask) (__builtin_ctz(_mask) >> 1)
+
+static inline fimd_simd_mask_t fimd_simd_stop_mask16(const uint16_t* pix_ptr, const uint16_t* term_ptr, uint16_t threshold)
+{
+    __m256i pix = _mm256_loadu_si256((const __m256i*) pix_ptr);
+    __m256i not_above = _mm256_cmpeq_epi16(_mm256_subs_epu16(pix, _mm256_set1_epi16((short) threshold)), _mm256_setzero_si256());
+    __m256i term = _mm256_and_si256(
+        _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*) term_ptr), _mm256_set1_epi16((short) FIMD_TERM_SEQ16_LO)),
+        _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*) (term_ptr + 1)), _mm256_set1_epi16((short) FIMD_TERM_SEQ16_HI))
+    );
+    return (fimd_simd_mask_t) _mm256_movemask_epi8(_mm256_or_si256(_mm256_xor_si256(not_above, _mm256_set1_epi8(-1)), term));
+}
+
+#elif !defined(FIMD_NO_SIMD) && defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#define FIMD_SIMD_NAME "sse2"
+#define FIMD_SIMD_WIDTH 16
+#define FIMD_SIMD_CTZ(_mask) __builtin_ctz(_mask)
+typedef uint32_t fimd_simd_mask_t;
+typedef __m128i fimd_simd_vec_t;
+
+static inline fimd_simd_vec_t fimd_simd_load(const uint8_t* ptr)
+{
+    return _mm_loadu_si128((const __m128i*) ptr);
+}
+
+static inline fimd_simd_mask_t fimd_simd_gt_mask(fimd_simd_vec_t vec, uint8_t threshold)
+{
+    // unsigned comparison: saturated subtraction of the threshold is zero for the pixels not above it
+    __m128i not_above = _mm_cmpeq_epi8(_mm_subs_epu8(vec, _mm_set1_epi8((char) threshold)), _mm_setzero_si128());
+    return ~((fimd_simd_mask_t) _mm_movemask_epi8(not_above)) & 0xFFFF;
+}
+
+static inline fimd_simd_mask_t fimd_simd_diff_gt_mask(fimd_simd_vec_t vec_a, fimd_simd_vec_t vec_b, uint8_t threshold)
+{
+    return fimd_simd_gt_mask(_mm_subs_epu8(vec_a, vec_b), threshold);
+}
+
+static inline fimd_simd_mask_t fimd_simd_term_mask(const uint8_t* ptr)
+{
+    __m128i term = _mm_and_si128(
+        _mm_cmpeq_epi8(fimd_simd_load(ptr), _mm_set1_epi8(FIMD_TERM_SEQ_LO)),
+        _mm_cmpeq_epi8(fimd_simd_load(ptr + 1), _mm_set1_epi8(FIMD_TERM_SEQ_HI))
+    );
+    return (fimd_simd_mask_t) _mm_movemask_epi8(term);
+}
+
+static inline fimd_simd_vec_t fimd_simd_zero_masked(fimd_simd_vec_t vec, fimd_simd_mask_t mask)
+{
+    // broadcast the mask bytes into the pixels (8 pixels per byte), then test the bit of each pixel
+    const __m128i selector = _mm_set1_epi64x(0x8040201008040201LL);
+    __m128i bytes = _mm_cvtsi32_si128((int) mask);
+    bytes = _mm_unpacklo_epi8(bytes, bytes);
+    bytes = _mm_unpacklo_epi16(bytes, bytes);
+    bytes = _mm_unpacklo_epi32(bytes, bytes);
+    __m128i zeroed = _mm_cmpeq_epi8(_mm_and_si128(bytes, selector), selector);
+    return _mm_andnot_si128(zeroed, vec);
+}
+
+static inline fimd_simd_vec_t fimd_simd_and(fimd_simd_vec_t vec_a, fimd_simd_vec_t vec_b)
+{
+    return _mm_and_si128(vec_a, vec_b);
+}
+
+static inline fimd_simd_vec_t fimd_simd_max(fimd_simd_vec_t vec_a, fimd_simd_vec_t vec_b)
+{
+    return _mm_max_epu8(vec_a, vec_b);
+}
+
+// two mask bits per 16-bit pixel (byte mask of the comparison results)
+#define FIMD_SIMD_WIDTH16 8
+#define FIMD_SIMD_CTZ16(_mask) (__builtin_ctz(_mask) >> 1)
+
+static inline fimd_simd_mask_t fimd_simd_stop_mask16(const uint16_t* pix_ptr, const uint16_t* term_ptr, uint16_t threshold)
+{
+    __m128i pix = _mm_loadu_si128((const __m128i*) pix_ptr);
+    __m128i not_above = _mm_cmpeq_epi16(_mm_subs_epu16(pix, _mm_set1_epi16((short) threshold)), _mm_setzero_si128());
+    __m128i term = _mm_and_si128(
+        _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*) term_ptr), _mm_set1_epi16((short) FIMD_TERM_SEQ16_LO)),
+        _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*) (term_ptr + 1)), _mm_set1_epi16((short) FIMD_TERM_SEQ16_HI))
+    );
+    return (fimd_simd_mask_t) _mm_movemask_epi8(_mm_or_si128(_mm_xor_si128(not_above, _mm_set1_epi8(-1)), term));
+}
+
+#else
+
+// scalar scan only
+#define FIMD_SIMD_NAME "scalar"
+#define FIMD_SIMD_WIDTH 0
+#define FIMD_SIMD_WIDTH16 0
+
+#endif
+
+#if FIMD_SIMD_WIDTH
+
+/**
+ * \brief Finds the pixels which require the scalar processing in a block of FIMD_SIMD_WIDTH pixels.
+ *
+ * Bit i of the mask is set if the pixel pix_ptr[i] is above the threshold, or if the termination sequence
+ * is present at term_ptr[i] (the scalar loop checks it before loading the pixel pix_ptr[i]).
+ *
+ * \param pix_ptr Pointer to the first pixel of the block.
+ * \param term_ptr Pointer to the first termination sequence position of the block.
+ * \param threshold Threshold value for the central pixel.
+ * \return Bit mask of the pixels for the scalar processing.
+ */
+static inline fimd_simd_mask_t fimd_simd_stop_mask(const uint8_t* pix_ptr, const uint8_t* term_ptr, uint8_t threshold)
+{
+    return fimd_simd_gt_mask(fimd_simd_load(pix_ptr), threshold) | fimd_simd_term_mask(term_ptr);
+}
+
+/**
+ * \brief Loads FIMD_SIMD_WIDTH consecutive bits of a bitmap (at least 16 bytes of padding must follow the bitmap).
+ *
+ * \param bitmap Pointer to the bitmap (bit i is stored in the byte i/8 as the bit i%8).
+ * \param index Index of the first bit.
+ * \return Bit mask with the bit i set if the bit (index + i) of the bitmap is set.
+ */
+static inline fimd_simd_mask_t fimd_simd_load_bits(const uint8_t* bitmap, uintptr_t index)
+{
+    uint64_t words[2];
+    unsigned shift = (unsigned) (index & 7);
+    memcpy(words, bitmap + (index >> 3), sizeof(words));
+#if FIMD_SIMD_WIDTH == 64
+    return (words[0] >> shift) | (shift ? (words[1] << (64 - shift)) : 0);
+#else
+    return (fimd_simd_mask_t) (words[0] >> shift);
+#endif
+}
+
+/**
+ * \brief Loads FIMD_SIMD_WIDTH pixels, the pixels with the bit set in the bitmap are read as zero.
+ *
+ * \param ptr Pointer to the first pixel.
+ * \param bitmap Pointer to the bitmap (see fimd_simd_load_bits()).
+ * \param index Index of the bit of the first pixel.
+ * \return Vector of the pixels.
+ */
+static inline fimd_simd_vec_t fimd_simd_load_unmasked(const uint8_t* ptr, const uint8_t* bitmap, uintptr_t index)
+{
+    return fimd_simd_zero_masked(fimd_simd_load(ptr), fimd_simd_load_bits(bitmap, index));
+}
+
+#endif
+
+
+#endif //FIMD_SIMD_H
@@ -0,0 +1,43 @@
+/**
+ * \file fimd_thresholds.h
+ * \author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \date December 2024
+ * \brief Internal header file with the runtime thresholds of the generated FIMD-CPU kernels.
+ * \copyright GNU Public License.
+ */
+
+#ifndef FIMD_THRESHOLDS_H
+#define FIMD_THRESHOLDS_H
+
+#include <stdint.h>
+
+/**
+ * \brief Thresholds of the detection.
+ *
+ * The generated kernels read the thresholds once per call into local constants, which stay in registers
+ * (or broadcast vectors) during the whole scan, so that they cost the same as the compile-time immediates.
+ */
+typedef struct fimd_thresholds_s {
+    // central pixel threshold (the central pixel must be above it)
+    uint8_t center;
+    // difference threshold between the central pixel and the boundary pixels
+    uint8_t diff;
+    // sun threshold (the central pixel of a sun point must be at least equal to it)
+    uint8_t sun;
+} fimd_thresholds_t;
+
+/**
+ * \brief Thresholds of the detection in the kernels with 16-bit pixels (scaled to the pixel depth by the caller).
+ */
+typedef struct fimd_thresholds16_s {
+    uint16_t center;
+    uint16_t diff;
+    uint16_t sun;
+} fimd_thresholds16_t;
+
+// Thresholds used by all kernels with 8-bit pixels, initialized from FIMD_THRESHOLD_CENTER, FIMD_THRESHOLD_DIFF and FIMD_THRESHOLD_SUN
+// (global to the process, shared by all contexts and threads, not changed during a detection)
+extern fimd_thresholds_t fimd_cpu_thresholds;
+
+
+#endif //FIMD_THRESHOLDS_H
@@ -0,0 +1,282 @@
+/**
+ * \file fimd_tracker.c
+ * \author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \date December 2024
+ * \brief Source file for the tracking detector of the FIMD-CPU library (detection in the predicted windows).
+ * \copyright GNU Public License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fimd_cpu.h"
+
+// Default policy of the full frame scans
+#define FIMD_TRACKER_FULL_SCAN_INTERVAL 30
+#define FIMD_TRACKER_WINDOW_MARGIN 8
+
+// Marker tracked over the frames (position in the last frame and velocity in pixels per frame)
+struct fimd_cpu_track_s {
+    int x;
+    int y;
+    int vx;
+    int vy;
+    // number of consecutive frames in which the marker was not detected (the position is predicted)
+    unsigned missed;
+};
+
+struct fimd_cpu_tracker_s {
+    fimd_cpu_ctx_t* ctx;
+    fimd_cpu_tracker_policy_t policy;
+    unsigned* radii;
+    unsigned radii_count;
+    unsigned radius_max;
+
+    // frames since the last full scan and the request of the full scan of the next frame
+    unsigned frames_count;
+    int full_scan;
+
+    // tracks of the previous frame and the tracks being built for the current frame (swapped after each frame)
+    struct fimd_cpu_track_s* tracks;
+    struct fimd_cpu_track_s* tracks_next;
+    unsigned tracks_count;
+    unsigned tracks_next_count;
+    unsigned tracks_max;
+    uint8_t* matched;
+    // search windows around the predicted positions of the tracks
+    fimd_cpu_roi_t* windows;
+
+    // detections of a single radius
+    unsigned (*markers)[2];
+    unsigned (*sun_pts)[2];
+    unsigned sun_pts_max;
+};
+
+fimd_cpu_tracker_t* fimd_cpu_tracker_create(unsigned width, unsigned height, unsigned stride, const unsigned radii[], unsigned radii_count, const fimd_cpu_tracker_policy_t* policy)
+{
+    fimd_cpu_tracker_t* tracker = (fimd_cpu_tracker_t*) calloc(1, sizeof(struct fimd_cpu_tracker_s));
+    if (!tracker) {
+        return NULL;
+    }
+
+    if (policy) {
+        tracker->policy = *policy;
+    } else {
+        tracker->policy.full_scan_interval = FIMD_TRACKER_FULL_SCAN_INTERVAL;
+        tracker->policy.window_margin = FIMD_TRACKER_WINDOW_MARGIN;
+        tracker->policy.max_missed_frames = 0;
+        tracker->policy.rescan_on_loss = 1;
+    }
+
+    tracker->tracks_max = fimd_cpu_get_max_markers_count();
+    tracker->sun_pts_max = fimd_cpu_get_max_sun_points_count();
+    tracker->ctx = fimd_cpu_ctx_create_resolution(width, height, stride);
+    tracker->radii = (unsigned*) malloc((radii_count + 1) * sizeof(unsigned));
+    tracker->tracks = (struct fimd_cpu_track_s*) malloc(tracker->tracks_max * sizeof(struct fimd_cpu_track_s));
+    tracker->tracks_next = (struct fimd_cpu_track_s*) malloc(tracker->tracks_max * sizeof(struct fimd_cpu_track_s));
+    tracker->matched = (uint8_t*) malloc(tracker->tracks_max * sizeof(uint8_t));
+    tracker->windows = (fimd_cpu_roi_t*) malloc(tracker->tracks_max * sizeof(fimd_cpu_roi_t));
+    tracker->markers = (unsigned (*)[2]) malloc(tracker->tracks_max * sizeof(*tracker->markers));
+    tracker->sun_pts = (unsigned (*)[2]) malloc(tracker->sun_pts_max * sizeof(*tracker->sun_pts));
+    if (!tracker->ctx || !tracker->radii || !tracker->tracks || !tracker->tracks_next || !tracker->matched || !tracker->windows || !tracker->markers || !tracker->sun_pts) {
+        fimd_cpu_tracker_destroy(tracker);
+        return NULL; // Resolution not supported or memory allocation error
+    }
+
+    memcpy(tracker->radii, radii, radii_count * sizeof(unsigned));
+    tracker->radii_count = radii_count;
+    for (unsigned i = 0; i < radii_count; i++) {
+        if (radii[i] > tracker->radius_max) {
+            tracker->radius_max = radii[i];
+        }
+    }
+    fimd_cpu_tracker_reset(tracker);
+
+    return tracker;
+}
+
+// detects all radii in the full frame or in the windows around the predicted positions of the tracks
+static int fimd_cpu_tracker_scan(fimd_cpu_tracker_t* tracker, const unsigned char* img_ptr, int full, unsigned markers[][3], unsigned* markers_num, unsigned sun_pts[][3], unsigned* sun_pts_num)
+{
+    *markers_num = 0;
+    *sun_pts_num = 0;
+
+    // windows of the central pixels, the detected peak lies within the radius from the central pixel
+    unsigned windows_count = 0;
+    int half = (int) (tracker->policy.window_margin + tracker->radius_max);
+    for (unsigned i = 0; i < tracker->tracks_count && !full; i++) {
+        const struct fimd_cpu_track_s* track = &tracker->tracks[i];
+        int x = track->x + track->vx - half;
+        int y = track->y + track->vy - half;
+        if (x + 2*half < 0 || y + 2*half < 0) {
+            continue;
+        }
+        fimd_cpu_roi_t* window = &tracker->windows[windows_count++];
+        window->x = (x > 0) ? (unsigned) x : 0;
+        window->y = (y > 0) ? (unsigned) y : 0;
+        window->width = (unsigned) (x + 2*half + 1) - window->x;
+        window->height = (unsigned) (y + 2*half + 1) - window->y;
+    }
+
+    for (unsigned i = 0; i < tracker->radii_count; i++) {
+        unsigned radius = tracker->radii[i];
+        unsigned radius_markers_num, radius_sun_pts_num;
+        int result;
+        if (full) {
+            result = fimd_cpu_ctx_detect_const(tracker->ctx, radius, img_ptr, tracker->markers, &radius_markers_num, tracker->sun_pts, &radius_sun_pts_num);
+        } else {
+            result = fimd_cpu_ctx_detect_roi(tracker->ctx, radius, img_ptr, tracker->windows, windows_count, tracker->markers, &radius_markers_num, tracker->sun_pts, &radius_sun_pts_num);
+        }
+        if (result != 0) {
+            return result;
+        }
+
+        // merged lists of all radii up to the limits
+        for (unsigned j = 0; j < radius_markers_num && *markers_num < tracker->tracks_max; j++) {
+            markers[*markers_num][0] = tracker->markers[j][0];
+            markers[*markers_num][1] = tracker->markers[j][1];
+            markers[*markers_num][2] = radius;
+            (*markers_num)++;
+        }
+        for (unsigned j = 0; j < radius_sun_pts_num && *sun_pts_num < tracker->sun_pts_max; j++) {
+            sun_pts[*sun_pts_num][0] = tracker->sun_pts[j][0];
+            sun_pts[*sun_pts_num][1] = tracker->sun_pts[j][1];
+            sun_pts[*sun_pts_num][2] = radius;
+            (*sun_pts_num)++;
+        }
+    }
+
+    return 0;
+}
+
+// builds the tracks of the current frame from the detected markers, returns the number of lost tracks
+static unsigned fimd_cpu_tracker_match(fimd_cpu_tracker_t* tracker, unsigned markers[][3], unsigned markers_num, int full)
+{
+    int margin = (int) tracker->policy.window_margin;
+    unsigned lost = 0;
+
+    tracker->tracks_next_count = 0;
+    memset(tracker->matched, 0, tracker->tracks_count * sizeof(uint8_t));
+    for (unsigned i = 0; i < markers_num; i++) {
+        int x = (int) markers[i][0];
+        int y = (int) markers[i][1];
+        int r = (int) markers[i][2];
+
+        // the same marker detected for another radius
+        int duplicate = 0;
+        for (unsigned j = 0; j < tracker->tracks_next_count && !duplicate; j++) {
+            duplicate = abs(tracker->tracks_next[j].x - x) <= r && abs(tracker->tracks_next[j].y - y) <= r;
+        }
+        if (duplicate) {
+            continue;
+        }
+
+        // the nearest track with the predicted position within the margin (Chebyshev distance)
+        int best = -1;
+        int best_dist = margin + 1;
+        for (unsigned j = 0; j < tracker->tracks_count; j++) {
+            const struct fimd_cpu_track_s* track = &tracker->tracks[j];
+            int dx = abs(track->x + track->vx - x);
+            int dy = abs(track->y + track->vy - y);
+            int dist = (dx > dy) ? dx : dy;
+            if (!tracker->matched[j] && dist < best_dist) {
+                best = (int) j;
+                best_dist = dist;
+            }
+        }
+
+        struct fimd_cpu_track_s* track = &tracker->tracks_next[tracker->tracks_next_count++];
+        track->x = x;
+        track->y = y;
+        track->vx = (best >= 0) ? x - tracker->tracks[best].x : 0;
+        track->vy = (best >= 0) ? y - tracker->tracks[best].y : 0;
+        track->missed = 0;
+        if (best >= 0) {
+            tracker->matched[best] = 1;
+        }
+    }
+
+    // the full scan replaces all tracks, otherwise the missed tracks are kept at the predicted position for a while
+    // (the tracks leaving the image are dropped, the windows do not test the central pixels near its border)
+    int border = margin + (int) tracker->radius_max;
+    int width = (int) fimd_cpu_ctx_get_image_width(tracker->ctx);
+    int height = (int) fimd_cpu_ctx_get_image_height(tracker->ctx);
+    for (unsigned j = 0; j < tracker->tracks_count && !full; j++) {
+        const struct fimd_cpu_track_s* track = &tracker->tracks[j];
+        int x = track->x + track->vx;
+        int y = track->y + track->vy;
+        if (tracker->matched[j] || x < border || y < border || x >= width - border || y >= height - border) {
+            continue;
+        }
+        if (track->missed < tracker->policy.max_missed_frames && tracker->tracks_next_count < tracker->tracks_max) {
+            struct fimd_cpu_track_s* next = &tracker->tracks_next[tracker->tracks_next_count++];
+            *next = *track;
+            next->x += track->vx;
+            next->y += track->vy;
+            next->missed++;
+        } else {
+            lost++;
+        }
+    }
+
+    return lost;
+}
+
+int fimd_cpu_tracker_detect(fimd_cpu_tracker_t* tracker, const unsigned char* img_ptr, unsigned markers[][3], unsigned* markers_num, unsigned sun_pts[][3], unsigned* sun_pts_num)
+{
+    int full = tracker->full_scan || (tracker->policy.full_scan_interval > 0 && tracker->frames_count >= tracker->policy.full_scan_interval);
+
+    int result = fimd_cpu_tracker_scan(tracker, img_ptr, full, markers, markers_num, sun_pts, sun_pts_num);
+    if (result != 0) {
+        return result;
+    }
+    unsigned lost = fimd_cpu_tracker_match(tracker, markers, *markers_num, full);
+
+    if (lost > 0 && tracker->policy.rescan_on_loss) {
+        // the windows missed a marker, the same frame is scanned fully (the tracks of the windows are discarded)
+        full = 1;
+        result = fimd_cpu_tracker_scan(tracker, img_ptr, full, markers, markers_num, sun_pts, sun_pts_num);
+        if (result != 0) {
+            return result;
+        }
+        fimd_cpu_tracker_match(tracker, markers, *markers_num, full);
+    }
+
+    struct fimd_cpu_track_s* tracks = tracker->tracks;
+    tracker->tracks = tracker->tracks_next;
+    tracker->tracks_next = tracks;
+    tracker->tracks_count = tracker->tracks_next_count;
+
+    tracker->full_scan = (lost > 0 && !full);
+    tracker->frames_count = (full) ? 1 : tracker->frames_count + 1;
+
+    return full;
+}
+
+void fimd_cpu_tracker_reset(fimd_cpu_tracker_t* tracker)
+{
+    tracker->tracks_count = 0;
+    tracker->frames_count = 0;
+    tracker->full_scan = 1;
+}
+
+unsigned fimd_cpu_tracker_get_tracks_count(const fimd_cpu_tracker_t* tracker)
+{
+    return tracker->tracks_count;
+}
+
+void fimd_cpu_tracker_destroy(fimd_cpu_tracker_t* tracker)
+{
+    if (!tracker) {
+        return;
+    }
+    fimd_cpu_ctx_destroy(tracker->ctx);
+    free(tracker->radii);
+    free(tracker->tracks);
+    free(tracker->tracks_next);
+    free(tracker->matched);
+    free(tracker->windows);
+    free(tracker->markers);
+    free(tracker->sun_pts);
+    free(tracker);
+}
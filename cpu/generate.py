@@ -8,7 +8,11 @@ Script for generation of FIMD-CPU approach using templates.
 """
 
 from argparse import ArgumentParser
-from os import path
+from os import path, listdir
+from math import exp, log
+from random import Random
+from re import finditer
+import json
 from sys import exit, argv, stdout
 
 
@@ -152,12 +156,219 @@ def get_boundary_evaluation_order(boundary: list) -> list:
 
 
 
+class ProfileReservoir:
+    """
+    Uniform sample of a fixed size from a stream of candidates (reservoir sampling, Algorithm L).
+    The candidates to store are selected before they are evaluated, so only the sampled candidates are evaluated.
+    """
+
+    def __init__(self, size: int, rng: Random):
+        """
+        Args:
+            size (int): Maximum number of the sampled candidates.
+            rng (Random): Random generator (seeded for a reproducible profile).
+        """
+        self.size = size
+        self.rng = rng
+        self.items = list()
+        self.seen = 0
+        self.weight = exp(log(self.uniform()) / size)
+        self.next = size + self.skip()
+
+    def uniform(self) -> float:
+        """Returns a random number from the open interval (0, 1)."""
+        u = self.rng.random()
+        while u == 0.0:
+            u = self.rng.random()
+        return u
+
+    def skip(self) -> int:
+        """Returns the number of the candidates skipped before the next stored one."""
+        return int(log(self.uniform()) / log(1.0 - self.weight))
+
+    def select(self, count: int) -> list:
+        """
+        Selects the candidates to store from the next count candidates of the stream.
+
+        Args:
+            count (int): Number of the next candidates.
+
+        Returns:
+            list: Pairs of the candidate index (0 to count-1) and the slot in the items, in the stream order.
+        """
+        selected = list()
+        first = self.seen
+        self.seen += count
+        filled = len(self.items)
+        for i in range(first, min(self.seen, self.size)):
+            selected.append((i - first, filled))
+            self.items.append(0)
+            filled += 1
+        while self.next < self.seen:
+            selected.append((self.next - first, self.rng.randrange(self.size)))
+            self.weight *= exp(log(self.uniform()) / self.size)
+            self.next += self.skip() + 1
+        return selected
+
+
+def get_rejection_bitsets(masks: list, boundary_num: int) -> list:
+    """
+    Transposes the rejection masks of the sampled candidates (bit per boundary pixel) into the bitsets of the boundary pixels.
+
+    Args:
+        masks (list of int): Rejection mask of each sampled candidate.
+        boundary_num (int): Number of boundary pixels.
+
+    Returns:
+        list: Rejection bitset of each boundary pixel (bit per sampled candidate).
+    """
+    to_digits = bytes.maketrans(b"\x00\x01", b"01")
+    return [int(bytes((m >> j) & 1 for m in masks).translate(to_digits) or b"0", 2) for j in range(boundary_num)]
+
+
+def get_profile_rejections(frame_paths: list, width: int, height: int, boundaries: dict, thresholds: tuple, samples: int) -> dict:
+    """
+    Evaluates the boundary tests of a uniform sample of the candidate central pixels of the profile frames.
+    Marker candidates are the pixels above the central threshold, the marker test of a boundary pixel rejects them
+    if the difference from the central pixel does not exceed the difference threshold.
+    Sun candidates are the pixels at least equal to the sun threshold, the sun test rejects them if the difference exceeds it.
+    The frames are read one at a time and at most the given number of marker and sun candidates is sampled for each radius
+    (with a fixed seed), so the memory does not depend on the number of frames.
+
+    Args:
+        frame_paths (list of str): Paths of the 8-bit frames without row padding.
+        width (int): Width of the frames.
+        height (int): Height of the frames.
+        boundaries (dict): Coordinates of boundary pixels for each radius.
+        thresholds (tuple): Central pixel, difference and sun thresholds.
+        samples (int): Maximum number of the sampled marker candidates and of the sampled sun candidates.
+
+    Returns:
+        dict: For each radius, rejection bitsets of the boundary pixels (bit per sampled candidate) and the number of sampled
+        candidates for markers and for sun points, followed by the total numbers of the marker and sun candidates.
+    """
+    threshold_center, threshold_diff, threshold_sun = thresholds
+    center_table = bytes(int(v > threshold_center) for v in range(256))
+    rng = Random(0)
+    reservoirs = {radius: (ProfileReservoir(samples, rng), ProfileReservoir(samples, rng)) for radius in boundaries}
+    totals = {radius: [0, 0] for radius in boundaries}
+
+    for frame_path in frame_paths:
+        with open(frame_path, "rb") as f:
+            frame = f.read()
+        above = [m.start() for m in finditer(b"\x01", frame.translate(center_table))]
+        for radius, boundary in boundaries.items():
+            # candidates with the whole circle inside the frame
+            offsets = [y*width + x for y, x in boundary]
+            markers = [i for i in above if radius*width <= i < (height - radius)*width and radius <= i % width < width - radius]
+            sun_pts = [i for i in markers if frame[i] >= threshold_sun]
+            totals[radius][0] += len(markers)
+            totals[radius][1] += len(sun_pts)
+            marker_reservoir, sun_reservoir = reservoirs[radius]
+            for candidates, reservoir, rejected_above in ((markers, marker_reservoir, False), (sun_pts, sun_reservoir, True)):
+                for index, slot in reservoir.select(len(candidates)):
+                    i = candidates[index]
+                    reservoir.items[slot] = sum(1 << j for j, offset in enumerate(offsets) if (frame[i] - frame[i + offset] > threshold_diff) == rejected_above)
+
+    profiles = dict()
+    for radius, boundary in boundaries.items():
+        marker_reservoir, sun_reservoir = reservoirs[radius]
+        profiles[radius] = (get_rejection_bitsets(marker_reservoir.items, len(boundary)), len(marker_reservoir.items),
+                            get_rejection_bitsets(sun_reservoir.items, len(boundary)), len(sun_reservoir.items),
+                            totals[radius][0], totals[radius][1])
+    return profiles
+
+
+def get_expected_comparisons(order: list, boundary: list, rejections: list, candidates: int) -> float:
+    """
+    Computes the mean number of boundary comparisons per candidate for the given evaluation order.
+
+    Args:
+        order (list of tuples): Boundary pixel coordinates in evaluation order.
+        boundary (list of tuples): Coordinates of boundary pixels (indexing the rejections).
+        rejections (list of int): Rejection bitsets of the boundary pixels.
+        candidates (int): Bitset of the candidates entering the first comparison of the order.
+
+    Returns:
+        float: Mean number of comparisons (0 without any candidates).
+    """
+    count = bin(candidates).count("1")
+    comparisons = 0
+    for pt in order:
+        comparisons += bin(candidates).count("1")
+        candidates &= ~rejections[boundary.index(pt)]
+    return comparisons / count if count > 0 else 0.0
+
+
+def get_profiled_evaluation_order(order: list, boundary: list, rejections: list, candidates: int) -> list:
+    """
+    Reorders the boundary pixels to minimize the expected number of comparisons of the profiled candidates.
+    Greedily picks the pixel rejecting most of the candidates that passed all previous pixels.
+    In case of equal rejections (e.g., no candidates left), the pixel from the given order is kept first.
+
+    Args:
+        order (list of tuples): Boundary pixel coordinates in the geometric evaluation order.
+        boundary (list of tuples): Coordinates of boundary pixels (indexing the rejections).
+        rejections (list of int): Rejection bitsets of the boundary pixels.
+        candidates (int): Bitset of the candidates entering the first comparison of the order.
+
+    Returns:
+        list: Boundary pixel coordinates in the profiled evaluation order.
+    """
+    remaining = list(order)
+    evaluation_order = list()
+    while len(remaining) > 0:
+        counts = [bin(candidates & rejections[boundary.index(pt)]).count("1") for pt in remaining]
+        pt = remaining.pop(counts.index(max(counts)))
+        evaluation_order.append(pt)
+        candidates &= ~rejections[boundary.index(pt)]
+    return evaluation_order
+
+
+def get_profile_evaluation_orders(order: list, boundary: list, profile: tuple) -> tuple:
+    """
+    Determines the marker and sun evaluation orders from the profile rejections.
+    Both orders share the first boundary pixel, which decides between the marker and the sun test
+    (only the sun candidates failing the marker test of the first pixel continue with the sun test).
+
+    Args:
+        order (list of tuples): Boundary pixel coordinates in the geometric evaluation order.
+        boundary (list of tuples): Coordinates of boundary pixels.
+        profile (tuple): Rejections and candidate counts of a radius returned by get_profile_rejections().
+
+    Returns:
+        tuple: Marker and sun evaluation orders, and the expected comparisons of the geometric and profiled orders.
+    """
+    marker_rejections, marker_count, sun_rejections, sun_count = profile[:4]
+    marker_candidates = (1 << marker_count) - 1
+    sun_candidates = (1 << sun_count) - 1
+    marker_order = get_profiled_evaluation_order(order, boundary, marker_rejections, marker_candidates)
+
+    first = boundary.index(marker_order[0])
+    sun_order = [marker_order[0]] + get_profiled_evaluation_order([pt for pt in order if pt != marker_order[0]], boundary, sun_rejections, sun_candidates & ~sun_rejections[first])
+
+    geometric_sun = sun_candidates & ~sun_rejections[boundary.index(order[0])]
+    comparisons = (get_expected_comparisons(order, boundary, marker_rejections, marker_candidates),
+                   get_expected_comparisons(order[1:], boundary, sun_rejections, geometric_sun),
+                   get_expected_comparisons(marker_order, boundary, marker_rejections, marker_candidates),
+                   get_expected_comparisons(sun_order[1:], boundary, sun_rejections, sun_candidates & ~sun_rejections[first]))
+    return marker_order, sun_order, comparisons
+
+
 if __name__ == "__main__":
     parser = ArgumentParser(description="Script for generation of FIMD-CPU approach using templates.")
-    parser.add_argument("-r", "--radius", type=int, required=True, help="Radius of the circle to generate.")
+    parser.add_argument("-r", "--radius", type=str, required=True, help="Radius of the circle to generate (comma-separated list of radii for fused templates).")
+    parser.add_argument("-s", "--stride", type=int, default=0, help="Row pitch of the image in bytes (distance between the rows in the generated offsets).")
+    parser.add_argument("-p", "--pixel-bits", type=int, default=8, choices=[8, 16], help="Bits per pixel of the generated kernels (16-bit pixels hold 9 to 16-bit data).")
     parser.add_argument("-t", "--template", type=str, default="", help="Template file for the code generation.")
     parser.add_argument("-o", "--output", type=str, default="", help="Output file for the generated code.")
     parser.add_argument("-v", "--verbose", action="store_true", help="Prints the generated code to the console.")
+    parser.add_argument("--profile", type=str, default="", help="Boundary evaluation orders written by --profile-output (the radii not in the file keep the geometric order).")
+    parser.add_argument("--profile-frames", type=str, default="", help="Comma-separated list of raw 8-bit frames (without row padding) or directories of them to profile the boundary evaluation order (the frames are read one at a time).")
+    parser.add_argument("--profile-size", type=str, default="752x480", help="Resolution of the profile frames as WIDTHxHEIGHT.")
+    parser.add_argument("--profile-thresholds", type=str, default="120,60,240", help="Central pixel, difference and sun thresholds of the profile (comma-separated).")
+    parser.add_argument("--profile-samples", type=int, default=100000, help="Number of the marker candidates and of the sun candidates sampled uniformly from all profile frames for each radius (100000 by default, reservoir sampling with a fixed seed, bounds the memory and the ordering time).")
+    parser.add_argument("--profile-output", type=str, default="", help="Output file for the profiled boundary evaluation orders.")
 
     if len(argv) == 1:
         parser.print_help(stdout)
@@ -165,36 +376,135 @@ if __name__ == "__main__":
 
     args = parser.parse_args()
 
+    try:
+        FIMD_RADII = sorted(set(int(r) for r in args.radius.split(",")))
+    except ValueError:
+        print("Error: Invalid radius '%s'." % args.radius)
+        exit(1)
+    if len(FIMD_RADII) == 0 or FIMD_RADII[0] < 1:
+        print("Error: Radii must be positive integers.")
+        exit(1)
+
+    # profile of the rejections on the real frames
+    FIMD_PROFILE_FRAMES = list()
+    if len(args.profile_frames) > 0:
+        try:
+            PROFILE_WIDTH, PROFILE_HEIGHT = (int(v) for v in args.profile_size.split("x"))
+            PROFILE_THRESHOLDS = tuple(int(v) for v in args.profile_thresholds.split(","))
+        except ValueError:
+            print("Error: Invalid profile resolution '%s' or thresholds '%s'." % (args.profile_size, args.profile_thresholds))
+            exit(1)
+        if len(PROFILE_THRESHOLDS) != 3:
+            print("Error: Invalid profile thresholds '%s'." % args.profile_thresholds)
+            exit(1)
+        if args.profile_samples < 1:
+            print("Error: Invalid number of profile samples %d." % args.profile_samples)
+            exit(1)
+        for frames_path in args.profile_frames.split(","):
+            if not path.exists(frames_path):
+                print("Error: Profile frame '%s' not found." % frames_path)
+                exit(1)
+            frame_paths = sorted(path.join(frames_path, name) for name in listdir(frames_path)) if path.isdir(frames_path) else [frames_path]
+            for frame_path in frame_paths:
+                if path.getsize(frame_path) != PROFILE_WIDTH * PROFILE_HEIGHT:
+                    print("Error: Profile frame '%s' has %d bytes instead of %d." % (frame_path, path.getsize(frame_path), PROFILE_WIDTH * PROFILE_HEIGHT))
+                    exit(1)
+                FIMD_PROFILE_FRAMES.append(frame_path)
+
+    # previously profiled orders
+    FIMD_PROFILE = dict()
+    if len(args.profile) > 0:
+        if not path.exists(args.profile):
+            print("Error: Profile file '%s' not found." % args.profile)
+            exit(1)
+        with open(args.profile, "r") as f:
+            FIMD_PROFILE = json.load(f)
+
     generation_only = len(args.template) == 0 or len(args.output) == 0
     if generation_only:
         print("Warning: No template or output file specified. Performing only the circle generation.")
     elif not path.exists(args.template):
         print("Error: Template file '%s' not found." % args.template)
         exit(1)
+    elif args.stride < 1 and "IM_STRIDE" in open(args.template).read():
+        print("Error: Template '%s' requires a positive row pitch (-s)." % args.template)
+        exit(1)
+    elif args.pixel_bits != 8 and "FIMD_PIXEL_BITS" not in open(args.template).read():
+        print("Error: Template '%s' supports only 8-bit pixels." % args.template)
+        exit(1)
 
     if args.verbose or generation_only:
         print("Starting", parser.description)
-        print("Selected circle radius:", args.radius)
-    
-    boundary, interior = bresenham_circle_points(args.radius)
+        print("Selected circle radii:", ", ".join(str(r) for r in FIMD_RADII))
 
-    if args.verbose or generation_only:
-        print("\nGenerated Bresenham circle:")
-        print("-- Boundary points:", len(boundary))
-        print("-- Interior points:", len(interior))
-        print("Visualization:")
-        print_circle(boundary, interior)
+    # profile of all radii in a single pass over the frames
+    FIMD_PROFILES = dict()
+    if len(FIMD_PROFILE_FRAMES) > 0:
+        boundaries = {radius: bresenham_circle_points(radius)[0] for radius in FIMD_RADII}
+        FIMD_PROFILES = get_profile_rejections(FIMD_PROFILE_FRAMES, PROFILE_WIDTH, PROFILE_HEIGHT, boundaries, PROFILE_THRESHOLDS, args.profile_samples)
 
-    FIMD_RADIUS = args.radius
-    FIMD_BOUNDARY = get_boundary_evaluation_order(boundary)
-    FIMD_INTERIOR = list(sorted([(y, x) for y, x in interior if y > 0 or (y == 0 and x >= 0)]))
+    # boundary and interior points in the evaluation order for each radius (the sun test continues after the first boundary point in its own order)
+    FIMD_BOUNDARIES = dict()
+    FIMD_BOUNDARIES_SUN = dict()
+    FIMD_INTERIORS = dict()
 
-    if args.verbose or generation_only:
-        print("\nPixel evaluation order:")
-        print("-- Boundary points:", len(FIMD_BOUNDARY))
-        print("-- Interior points:", len(FIMD_INTERIOR))
-        print("Visualization:")
-        print_circle(FIMD_BOUNDARY, FIMD_INTERIOR)
+    for radius in FIMD_RADII:
+        boundary, interior = bresenham_circle_points(radius)
+
+        if args.verbose or generation_only:
+            print("\nGenerated Bresenham circle (radius %d):" % radius)
+            print("-- Boundary points:", len(boundary))
+            print("-- Interior points:", len(interior))
+            print("Visualization:")
+            print_circle(boundary, interior)
+
+        FIMD_BOUNDARIES[radius] = get_boundary_evaluation_order(boundary)
+        FIMD_BOUNDARIES_SUN[radius] = FIMD_BOUNDARIES[radius]
+
+        if len(FIMD_PROFILE_FRAMES) > 0:
+            profile = FIMD_PROFILES[radius]
+            marker_order, sun_order, comparisons = get_profile_evaluation_orders(FIMD_BOUNDARIES[radius], boundary, profile)
+            print("Profiled radius %d: %d of %d marker candidates, %.2f -> %.2f comparisons, %d of %d sun candidates, %.2f -> %.2f comparisons"
+                  % (radius, profile[1], profile[4], comparisons[0], comparisons[2], profile[3], profile[5], comparisons[1], comparisons[3]))
+            FIMD_BOUNDARIES[radius] = marker_order
+            FIMD_BOUNDARIES_SUN[radius] = sun_order
+        elif str(radius) in FIMD_PROFILE:
+            # the profiled orders must contain exactly the boundary points of this radius
+            marker_order = [tuple(pt) for pt in FIMD_PROFILE[str(radius)]["marker"]]
+            sun_order = [tuple(pt) for pt in FIMD_PROFILE[str(radius)]["sun"]]
+            if sorted(marker_order) != sorted(boundary) or sorted(sun_order) != sorted(boundary) or marker_order[0] != sun_order[0]:
+                print("Error: Profile '%s' does not match the boundary of radius %d." % (args.profile, radius))
+                exit(1)
+            FIMD_BOUNDARIES[radius] = marker_order
+            FIMD_BOUNDARIES_SUN[radius] = sun_order
+        FIMD_INTERIORS[radius] = list(sorted([(y, x) for y, x in interior if y > 0 or (y == 0 and x >= 0)]))
+
+        if args.verbose or generation_only:
+            print("\nPixel evaluation order (radius %d):" % radius)
+            print("-- Boundary points:", len(FIMD_BOUNDARIES[radius]))
+            print("-- Interior points:", len(FIMD_INTERIORS[radius]))
+            print("Visualization:")
+            print_circle(FIMD_BOUNDARIES[radius], FIMD_INTERIORS[radius])
+            if FIMD_BOUNDARIES_SUN[radius] != FIMD_BOUNDARIES[radius]:
+                print("\nSun test evaluation order (radius %d):" % radius)
+                print_circle(FIMD_BOUNDARIES_SUN[radius], list())
+
+    if len(args.profile_output) > 0:
+        with open(args.profile_output, "w") as f:
+            json.dump({str(r): {"marker": FIMD_BOUNDARIES[r], "sun": FIMD_BOUNDARIES_SUN[r]} for r in FIMD_RADII}, f)
+        print("Written boundary evaluation orders to file:", args.profile_output)
+
+    # row pitch of the image, used by the templates in the offsets and the function names
+    FIMD_STRIDE = args.stride
+
+    # bits per pixel (pixel type) of the generated kernels, the row pitch and the offsets are in pixels
+    FIMD_PIXEL_BITS = args.pixel_bits
+
+    # single radius templates use the first (smallest) radius
+    FIMD_RADIUS = FIMD_RADII[0]
+    FIMD_BOUNDARY = FIMD_BOUNDARIES[FIMD_RADIUS]
+    FIMD_BOUNDARY_SUN = FIMD_BOUNDARIES_SUN[FIMD_RADIUS]
+    FIMD_INTERIOR = FIMD_INTERIORS[FIMD_RADIUS]
 
     if generation_only:
         exit(0)
@@ -219,5 +529,5 @@ if __name__ == "__main__":
         print("Written generated code to file:", args.output)
         print("Script finished.")
     else:
-        print("[Python generator] Finished: Radius: %4d, Boundary length: %4d, Interior length: %4d | Written as: %s" % (FIMD_RADIUS, len(FIMD_BOUNDARY), len(FIMD_INTERIOR), args.output))
-
+        for radius in FIMD_RADII:
+            print("[Python generator] Finished: Radius: %4d, Boundary length: %4d, Interior length: %4d | Written as: %s" % (radius, len(FIMD_BOUNDARIES[radius]), len(FIMD_INTERIORS[radius]), args.output))
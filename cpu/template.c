@@ -1,52 +1,153 @@
+//$ FIMD_FUNC_NAME = "fimd_r%d_w%d" % (FIMD_RADIUS, FIMD_STRIDE) + ("_p%d" % (FIMD_PIXEL_BITS) if FIMD_PIXEL_BITS != 8 else "")
 //$ GEN_OUTPUT.append("""
 /**
- * \\file fimd_r%d.c
+ * \\file %s.c
  * \\author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
  * \\date December 2024
- * \\brief Generated source file for the FIMD-CPU library.
+ * \\brief Generated source file for the FIMD-CPU library (%d-bit pixels).
  * \\copyright GNU Public License.
  */
-//$ """ % (FIMD_RADIUS))
+//$ """ % (FIMD_FUNC_NAME, FIMD_PIXEL_BITS))
 //$ GEN_OUTPUT.append("""
 #include <stdint.h>
 
+#include "fimd_simd.h"
+#include "fimd_thresholds.h"
+
+#define IM_STRIDE 0 // placeholder
 #define FIMD_RADIUS 0 // placeholder
+#define FIMD_PIXEL_BITS 0 // placeholder
 #define FIMD_BOUNDARY_PTxx 0 // placeholder
 #define FIMD_INTERIOR_PTxx 0 // placeholder
-#define FIMD_OFFSET ((IM_WIDTH * FIMD_RADIUS) + FIMD_RADIUS)
-#define ADD_TERM_SEQ(_ptr) (*((uint16_t*) ((_ptr) + FIMD_OFFSET)) = FIMD_TERM_SEQ)
-#define CHECK_TERM_SEQ(_ptr) *((uint16_t*) ((_ptr) + FIMD_OFFSET)) == FIMD_TERM_SEQ
-//$ """.replace("FIMD_RADIUS 0", "FIMD_RADIUS %d" % (FIMD_RADIUS)))
+#define FIMD_OFFSET ((IM_STRIDE * FIMD_RADIUS) + FIMD_RADIUS)
+
+// pixel type, the offsets and the row pitch are in pixels (the termination sequence spans two pixels)
+#if FIMD_PIXEL_BITS == 8
+typedef uint8_t fimd_pixel_t;
+typedef uint16_t fimd_pixel_pair_t;
+#define FIMD_PIXEL_TERM_SEQ FIMD_TERM_SEQ
+#else
+typedef uint16_t fimd_pixel_t;
+typedef uint32_t fimd_pixel_pair_t;
+#define FIMD_PIXEL_TERM_SEQ FIMD_TERM_SEQ16
+#endif
+#define ADD_TERM_SEQ(_ptr) (*((fimd_pixel_pair_t*) ((_ptr) + FIMD_OFFSET)) = FIMD_PIXEL_TERM_SEQ)
+#define CHECK_TERM_SEQ(_ptr) *((fimd_pixel_pair_t*) ((_ptr) + FIMD_OFFSET)) == FIMD_PIXEL_TERM_SEQ
+
+// vector skip-ahead scan over the blocks of pixels of the pixel type
+#if FIMD_PIXEL_BITS == 8
+#define FIMD_BLOCK_WIDTH FIMD_SIMD_WIDTH
+#define FIMD_BLOCK_STOP_MASK(_pix_ptr, _term_ptr, _threshold) fimd_simd_stop_mask(_pix_ptr, _term_ptr, _threshold)
+#define FIMD_BLOCK_CTZ(_mask) FIMD_SIMD_CTZ(_mask)
+#else
+#define FIMD_BLOCK_WIDTH FIMD_SIMD_WIDTH16
+#define FIMD_BLOCK_STOP_MASK(_pix_ptr, _term_ptr, _threshold) fimd_simd_stop_mask16(_pix_ptr, _term_ptr, _threshold)
+#define FIMD_BLOCK_CTZ(_mask) FIMD_SIMD_CTZ16(_mask)
+#endif
+
+// vector boundary test of the bright pixels found by the skip-ahead scan (8-bit pixels only)
+#if FIMD_BLOCK_WIDTH && FIMD_PIXEL_BITS == 8 && !defined(FIMD_NO_SIMD_BOUNDARY)
+#define FIMD_SIMD_BOUNDARY 1
+#else
+#define FIMD_SIMD_BOUNDARY 0
+#endif
+//$ """.replace("IM_STRIDE 0", "IM_STRIDE %d" % (FIMD_STRIDE)).replace("FIMD_RADIUS 0", "FIMD_RADIUS %d" % (FIMD_RADIUS)).replace("FIMD_PIXEL_BITS 0", "FIMD_PIXEL_BITS %d" % (FIMD_PIXEL_BITS)))
 
 //$ GEN_OUTPUT.append("""
-uint8_t* FIMD_FUNC(uint8_t* img_ptr, uintptr_t* markers, uint32_t* markers_num, uintptr_t* sun_pts, uint32_t* sun_pts_num)
+#if FIMD_PIXEL_BITS == 8
+uint8_t* FIMD_KERNEL_NAME(FIMD_FUNC)(uint8_t* img_ptr, uint8_t* img_end, uintptr_t* markers, uint32_t* markers_num, uintptr_t* sun_pts, uint32_t* sun_pts_num)
+{
+    // thresholds kept in registers during the whole scan (see fimd_thresholds.h)
+    const uint8_t threshold_center = fimd_cpu_thresholds.center;
+    const uint8_t threshold_diff = fimd_cpu_thresholds.diff;
+    const uint8_t threshold_sun = fimd_cpu_thresholds.sun;
+#else
+uint16_t* FIMD_KERNEL_NAME(FIMD_FUNC)(uint16_t* img_ptr, uint16_t* img_end, const fimd_thresholds16_t* thresholds, uintptr_t* markers, uint32_t* markers_num, uintptr_t* sun_pts, uint32_t* sun_pts_num)
 {
-    // append termination sequence to image end
-    *((uint16_t*) ((img_ptr) + (IM_WIDTH * IM_HEIGHT) - 2)) = FIMD_TERM_SEQ;
+    // thresholds scaled to the pixel depth by the caller, kept in registers during the whole scan
+    const uint16_t threshold_center = thresholds->center;
+    const uint16_t threshold_diff = thresholds->diff;
+    const uint16_t threshold_sun = thresholds->sun;
+#endif
+#if FIMD_SIMD_BOUNDARY
+    // vector sun test of the bright pixels: above (threshold_sun - 1), i.e., at least threshold_sun
+    const uint8_t threshold_sun_above = (threshold_sun > 0) ? (uint8_t) (threshold_sun - 1) : 0;
+#endif
+
+    // the termination sequence must be already present after the last central pixel to process,
+    // i.e., at the address (img_ptr + FIMD_OFFSET + last_offset), where the last_offset is relative to img_ptr
+    // (for the whole frame, the caller writes it into the last two pixels of the image)
+
+    // (img_end points right after the last pixel which can be read, it only limits the vector loads)
+
+#if FIMD_BLOCK_WIDTH
+    // last position for the vector skip-ahead scan (reads up to img_ptr + FIMD_OFFSET + FIMD_BLOCK_WIDTH)
+    fimd_pixel_t* simd_end = img_end - (FIMD_OFFSET + FIMD_BLOCK_WIDTH);
+#else
+    (void) img_end;
+#endif
 
     // initial shift by central pixel offset - 1
-    img_ptr = (uint8_t*) (img_ptr + (FIMD_OFFSET-1));
-//$ """.replace("FIMD_FUNC", "fimd_r%d" % (FIMD_RADIUS)))
+    img_ptr = (fimd_pixel_t*) (img_ptr + (FIMD_OFFSET-1));
+//$ """.replace("FIMD_FUNC", FIMD_FUNC_NAME))
 
 //$ GEN_OUTPUT.append("""
 LOOP:
+#if FIMD_BLOCK_WIDTH
+    // skip ahead over the dark pixels, stop right before the first candidate pixel or termination sequence
+    while (img_ptr < simd_end) {
+        fimd_simd_mask_t stop_mask = FIMD_BLOCK_STOP_MASK(img_ptr + 1, img_ptr + FIMD_OFFSET, threshold_center);
+#if FIMD_SIMD_BOUNDARY
+        // test the boundaries of all pixels of the block at once and stop only before the pixels passing
+        // the whole marker or sun test (evaluated again by the scalar code, which also zeroes the interior)
+        // or before the termination sequence (the scalar code handles the full sun points limit)
+        if (stop_mask && *sun_pts_num != FIMD_MAX_SUN_PTS_COUNT) {
+            fimd_simd_vec_t center = fimd_simd_load(img_ptr + 1);
+            fimd_simd_mask_t marker_mask = fimd_simd_gt_mask(center, threshold_center);
+            fimd_simd_mask_t sun_mask = marker_mask & fimd_simd_gt_mask(center, threshold_sun_above);
+            fimd_simd_mask_t diff_mask;
+            do {
+//$ """)
+
+//$ for i, (y, x) in enumerate(FIMD_BOUNDARY):
+//$     GEN_OUTPUT.append(("""
+                // boundary pixel #%d, compare differences from central pixels
+                diff_mask = fimd_simd_diff_gt_mask(center, fimd_simd_load(img_ptr + 1 + FIMD_BOUNDARY_PTxx), threshold_diff);
+                marker_mask &= diff_mask;
+                sun_mask &= ~diff_mask;
+                if (!(marker_mask | sun_mask)) break;
+//$     """ % (i)).replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)))
+
+//$ GEN_OUTPUT.append("""
+            } while (0);
+            stop_mask = marker_mask | sun_mask | fimd_simd_term_mask(img_ptr + FIMD_OFFSET);
+        }
+#endif
+        if (stop_mask) {
+            img_ptr += FIMD_BLOCK_CTZ(stop_mask);
+            break;
+        }
+        img_ptr += FIMD_BLOCK_WIDTH;
+    }
+#endif
+
     // check for the presence of the termination sequence
     if (CHECK_TERM_SEQ(img_ptr)) return img_ptr;
 
     // load new pixel value from pre-incremented address
-    uint8_t pix_val = *((uint8_t*) (++img_ptr));
-    if (pix_val <= FIMD_THRESHOLD_CENTER) goto LOOP;
+    fimd_pixel_t pix_val = *((fimd_pixel_t*) (++img_ptr));
+    if (pix_val <= threshold_center) goto LOOP;
 
     // first boundary pixel test - decide between MARKER_TEST and SUN_TEST
-    if ((pix_val - *((uint8_t*) (img_ptr + FIMD_BOUNDARY_PTxx))) <= FIMD_THRESHOLD_DIFF) {
-        if (pix_val >= FIMD_THRESHOLD_SUN) goto SUN_TEST;
+    if ((pix_val - *((fimd_pixel_t*) (img_ptr + FIMD_BOUNDARY_PTxx))) <= threshold_diff) {
+        if (pix_val >= threshold_sun) goto SUN_TEST;
     } else {
         goto MARKER_TEST;
     }
 
     // otherwise go to the next pixel
     goto LOOP;
-//$ """.replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_WIDTH))+(%d))" % FIMD_BOUNDARY[0]))
+//$ """.replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % FIMD_BOUNDARY[0]))
 
 //$ GEN_OUTPUT.append("""
 // testing for sun potential
@@ -58,17 +159,17 @@ SUN_TEST:
     }
 //$ """)
 
-//$ for i, (y, x) in enumerate(FIMD_BOUNDARY[1:]):
+//$ for i, (y, x) in enumerate(FIMD_BOUNDARY_SUN[1:]):
 //$     GEN_OUTPUT.append(("""
     // boundary pixel #%d, compare difference from central pixel
-    if ((pix_val - *((uint8_t*) (img_ptr + FIMD_BOUNDARY_PTxx))) > FIMD_THRESHOLD_DIFF) goto LOOP;
-//$     """ % (i+1)).replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_WIDTH))+(%d))" % (y, x)))
+    if ((pix_val - *((fimd_pixel_t*) (img_ptr + FIMD_BOUNDARY_PTxx))) > threshold_diff) goto LOOP;
+//$     """ % (i+1)).replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)))
 
 //$ for i, (y, x) in enumerate(FIMD_INTERIOR):
 //$     GEN_OUTPUT.append(("""
     // interior pixel #%d set to 0
-    *((uint8_t*) (img_ptr + FIMD_INTERIOR_PTxx)) = 0x00;
-//$     """ % (i)).replace("FIMD_INTERIOR_PTxx", "(((%d)*(IM_WIDTH))+(%d))" % (y, x)))
+    *((fimd_pixel_t*) (img_ptr + FIMD_INTERIOR_PTxx)) = 0x00;
+//$     """ % (i)).replace("FIMD_INTERIOR_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)))
 
 //$ GEN_OUTPUT.append("""
     // store current pixel address as sun detection
@@ -85,26 +186,26 @@ MARKER_TEST:
 //$ for i, (y, x) in enumerate(FIMD_BOUNDARY[1:]):
 //$     GEN_OUTPUT.append(("""
     // boundary pixel #%d, compare difference from central pixel
-    if (pix_val - (*((uint8_t*) (img_ptr + FIMD_BOUNDARY_PTxx))) <= FIMD_THRESHOLD_DIFF) goto LOOP;
-//$     """ % (i+1)).replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_WIDTH))+(%d))" % (y, x)))
+    if (pix_val - (*((fimd_pixel_t*) (img_ptr + FIMD_BOUNDARY_PTxx))) <= threshold_diff) goto LOOP;
+//$     """ % (i+1)).replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)))
 
 //$ GEN_OUTPUT.append("""
     // marker potential preserved, search for peak in interior
-    uint8_t peak = 0;
+    fimd_pixel_t peak = 0;
     uintptr_t peak_ptr = 0;
-    uint8_t* curr_int_ptr = 0;
+    fimd_pixel_t* curr_int_ptr = 0;
 //$ """)
 
 //$ for i, (y, x) in enumerate(FIMD_INTERIOR):
 //$     GEN_OUTPUT.append(("""
     // interior pixel #%d compare with latest peak
-    curr_int_ptr = (uint8_t*) (img_ptr + FIMD_INTERIOR_PTxx);
+    curr_int_ptr = (fimd_pixel_t*) (img_ptr + FIMD_INTERIOR_PTxx);
     if (*curr_int_ptr > peak) {
         peak = *curr_int_ptr;
         peak_ptr = (uintptr_t) curr_int_ptr;
     }
     *curr_int_ptr = 0;
-//$     """ % (i)).replace("FIMD_INTERIOR_PTxx", "(((%d)*(IM_WIDTH))+(%d))" % (y, x)))
+//$     """ % (i)).replace("FIMD_INTERIOR_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)))
 
 
 //$ GEN_OUTPUT.append("""
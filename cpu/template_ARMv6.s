@@ -68,7 +68,7 @@ SUN_TEST:
 	BEQ LOOP
 //$ """)
 
-//$ for i, (y, x) in enumerate(FIMD_BOUNDARY[1:]):
+//$ for i, (y, x) in enumerate(FIMD_BOUNDARY_SUN[1:]):
 //$     GEN_OUTPUT.append(("""
     // boundary pixel #%d to R3, compare R3-R2 and Td
 	LDR R3, =(FIMD_BOUNDARY_PTxx)
@@ -0,0 +1,259 @@
+//$ GEN_OUTPUT.append("""
+/**
+ * \\file fimd_bounded_r%d_w%d.c
+ * \\author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \\date December 2024
+ * \\brief Generated source file for the FIMD-CPU library (bounded kernel with read-only input).
+ * \\copyright GNU Public License.
+ */
+//$ """ % (FIMD_RADIUS, FIMD_STRIDE))
+//$ GEN_OUTPUT.append("""
+#include <stdint.h>
+
+#include "fimd_scan.h"
+#include "fimd_simd.h"
+#include "fimd_thresholds.h"
+
+#define IM_STRIDE 0 // placeholder
+#define FIMD_RADIUS 0 // placeholder
+#define FIMD_BOUNDARY_PTxx 0 // placeholder
+#define FIMD_INTERIOR_PTxx 0 // placeholder
+#define FIMD_OFFSET ((IM_STRIDE * FIMD_RADIUS) + FIMD_RADIUS)
+
+// moves the current row forward to the row of the central pixel (the central pixels only move forward)
+#define UPDATE_ROW() while (img_ptr >= row_end) { row++; row_end += IM_STRIDE; }
+
+// value of the pixel at the given offset from the central pixel (suppressed pixels are read as zero)
+#define PIXEL(_offset) (FIMD_SCAN_IS_SUPPRESSED(suppressed, center_index + (_offset)) ? 0 : img_ptr[_offset])
+
+// block of the pixels at the given offset from the central pixels of the block (suppressed pixels are read as zero if needed)
+#define BLOCK(_offset) (block_masked ? fimd_simd_load_unmasked(img_ptr + 1 + (_offset), suppressed, block_index + (_offset)) : fimd_simd_load(img_ptr + 1 + (_offset)))
+
+// vector boundary test of the bright pixels found by the skip-ahead scan
+#if FIMD_SIMD_WIDTH && !defined(FIMD_NO_SIMD_BOUNDARY)
+#define FIMD_SIMD_BOUNDARY 1
+#else
+#define FIMD_SIMD_BOUNDARY 0
+#endif
+//$ """.replace("IM_STRIDE 0", "IM_STRIDE %d" % (FIMD_STRIDE)).replace("FIMD_RADIUS 0", "FIMD_RADIUS %d" % (FIMD_RADIUS)))
+
+//$ GEN_OUTPUT.append("""
+const uint8_t* FIMD_KERNEL_NAME(FIMD_FUNC)(fimd_scan_t* scan)
+{
+    // thresholds kept in registers during the whole scan (see fimd_thresholds.h)
+    const uint8_t threshold_center = fimd_cpu_thresholds.center;
+    const uint8_t threshold_diff = fimd_cpu_thresholds.diff;
+    const uint8_t threshold_sun = fimd_cpu_thresholds.sun;
+#if FIMD_SIMD_BOUNDARY
+    // vector sun test of the bright pixels: above (threshold_sun - 1), i.e., at least threshold_sun
+    const uint8_t threshold_sun_above = (threshold_sun > 0) ? (uint8_t) (threshold_sun - 1) : 0;
+#endif
+
+    // the scan state is kept in local variables and stored back on exit
+    const uint8_t* img = scan->img;
+    const uint8_t* img_ptr = scan->begin - 1;
+    const uint8_t* scan_end = scan->end;
+    uint8_t* suppressed = scan->suppressed;
+    uintptr_t suppressed_begin = scan->suppressed_begin;
+    uintptr_t suppressed_end = scan->suppressed_end;
+    fimd_cpu_point_t* markers = scan->markers;
+    fimd_cpu_centroid_t* centroids = scan->centroids;
+    uint32_t markers_num = scan->markers_num;
+    uint32_t markers_max = scan->markers_max;
+    fimd_cpu_point_t* sun_pts = scan->sun_pts;
+    uint32_t sun_pts_num = scan->sun_pts_num;
+    uint32_t sun_pts_max = scan->sun_pts_max;
+    uintptr_t center_index;
+    uint8_t pix_val;
+
+    // row of the central pixel is tracked incrementally, so that the coordinates need no division
+    uint32_t row = (uint32_t) ((scan->begin - img) / IM_STRIDE);
+    const uint8_t* row_end = img + (uintptr_t) (row + 1) * IM_STRIDE;
+
+#if FIMD_SIMD_WIDTH
+    // last position for the vector skip-ahead scan (reads up to img_ptr + FIMD_OFFSET + FIMD_SIMD_WIDTH),
+    // short ranges (e.g., rows of the regions of interest) stop at most one block after their end
+    const uint8_t* simd_end = scan->read_end - (FIMD_OFFSET + FIMD_SIMD_WIDTH);
+    if (simd_end > scan_end) simd_end = scan_end;
+#endif
+
+    // no detection can be stored
+    if (markers_num >= markers_max) {
+        img_ptr = scan->begin;
+        goto DONE;
+    }
+//$ """.replace("FIMD_FUNC", "fimd_bounded_r%d_w%d" % (FIMD_RADIUS, FIMD_STRIDE)))
+
+//$ GEN_OUTPUT.append("""
+LOOP:
+#if FIMD_SIMD_WIDTH
+    // skip ahead over the dark pixels, stop right before the first pixel above the threshold
+    // (the suppressed pixels may stop the scan, the scalar code skips them)
+    while (img_ptr < simd_end) {
+        fimd_simd_mask_t stop_mask = fimd_simd_gt_mask(fimd_simd_load(img_ptr + 1), threshold_center);
+#if FIMD_SIMD_BOUNDARY
+        // test the boundaries of all pixels of the block at once and stop only before the pixels passing
+        // the whole marker or sun test (the scalar code handles the full sun points limit)
+        if (stop_mask && sun_pts_num < sun_pts_max) {
+            // the suppression bitmap is applied only if the test of the block reads any pixel of the suppressed range
+            uintptr_t block_index = (uintptr_t) (img_ptr + 1 - img);
+            int block_masked = suppressed_begin != suppressed_end && block_index < suppressed_end + FIMD_OFFSET
+                               && block_index + FIMD_SIMD_WIDTH + FIMD_OFFSET > suppressed_begin;
+            fimd_simd_vec_t center = BLOCK(0);
+            fimd_simd_mask_t marker_mask = fimd_simd_gt_mask(center, threshold_center);
+            fimd_simd_mask_t sun_mask = marker_mask & fimd_simd_gt_mask(center, threshold_sun_above);
+            fimd_simd_mask_t diff_mask;
+            do {
+//$ """)
+
+//$ for i, (y, x) in enumerate(FIMD_BOUNDARY):
+//$     GEN_OUTPUT.append(("""
+                // boundary pixel #%d, compare differences from central pixels
+                diff_mask = fimd_simd_diff_gt_mask(center, BLOCK(FIMD_BOUNDARY_PTxx), threshold_diff);
+                marker_mask &= diff_mask;
+                sun_mask &= ~diff_mask;
+                if (!(marker_mask | sun_mask)) break;
+//$     """ % (i)).replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)))
+
+//$ GEN_OUTPUT.append("""
+            } while (0);
+            stop_mask = marker_mask | sun_mask;
+        }
+#endif
+        if (stop_mask) {
+            img_ptr += FIMD_SIMD_CTZ(stop_mask);
+            break;
+        }
+        img_ptr += FIMD_SIMD_WIDTH;
+    }
+#endif
+
+    // check for the end of the scanned range
+    if (++img_ptr >= scan_end) {
+        img_ptr = scan_end;
+        goto DONE;
+    }
+
+    // load new pixel value, suppressed central pixels are skipped
+    pix_val = *img_ptr;
+    if (pix_val <= threshold_center) goto LOOP;
+    center_index = (uintptr_t) (img_ptr - img);
+    if (FIMD_SCAN_IS_SUPPRESSED(suppressed, center_index)) goto LOOP;
+
+    // first boundary pixel test - decide between MARKER_TEST and SUN_TEST
+    if ((pix_val - PIXEL(FIMD_BOUNDARY_PTxx)) <= threshold_diff) {
+        if (pix_val >= threshold_sun) goto SUN_TEST;
+    } else {
+        goto MARKER_TEST;
+    }
+
+    // otherwise go to the next pixel
+    goto LOOP;
+//$ """.replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % FIMD_BOUNDARY[0]))
+
+//$ GEN_OUTPUT.append("""
+// testing for sun potential
+SUN_TEST:
+    // check the current number of the detected sun points
+    if (sun_pts_num >= sun_pts_max) goto DONE;
+//$ """)
+
+//$ for i, (y, x) in enumerate(FIMD_BOUNDARY_SUN[1:]):
+//$     GEN_OUTPUT.append(("""
+    // boundary pixel #%d, compare difference from central pixel
+    if ((pix_val - PIXEL(FIMD_BOUNDARY_PTxx)) > threshold_diff) goto LOOP;
+//$     """ % (i+1)).replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)))
+
+//$ for i, (y, x) in enumerate(FIMD_INTERIOR):
+//$     GEN_OUTPUT.append(("""
+    // interior pixel #%d suppressed
+    FIMD_SCAN_SUPPRESS(suppressed, center_index + FIMD_INTERIOR_PTxx);
+//$     """ % (i)).replace("FIMD_INTERIOR_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)))
+
+//$ GEN_OUTPUT.append("""
+    // extend the range of the suppressed pixels (the interior lies in [center_index, center_index + FIMD_OFFSET))
+    if (suppressed_begin == suppressed_end || center_index < suppressed_begin) suppressed_begin = center_index;
+    if (center_index + FIMD_OFFSET > suppressed_end) suppressed_end = center_index + FIMD_OFFSET;
+
+    // store current pixel coordinates as sun detection
+    UPDATE_ROW();
+    sun_pts[sun_pts_num].x = (uint16_t) (img_ptr - (row_end - IM_STRIDE));
+    sun_pts[sun_pts_num].y = (uint16_t) row;
+    sun_pts_num++;
+    goto LOOP;
+//$ """)
+
+//$ GEN_OUTPUT.append("""
+// testing for marker potential
+MARKER_TEST:
+//$ """)
+
+//$ for i, (y, x) in enumerate(FIMD_BOUNDARY[1:]):
+//$     GEN_OUTPUT.append(("""
+    // boundary pixel #%d, compare difference from central pixel
+    if (pix_val - PIXEL(FIMD_BOUNDARY_PTxx) <= threshold_diff) goto LOOP;
+//$     """ % (i+1)).replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)))
+
+//$ GEN_OUTPUT.append("""
+    // marker potential preserved, search for peak in interior
+    {
+        uint8_t peak = 0;
+        int32_t peak_x = 0;
+        int32_t peak_y = 0;
+        uint8_t curr_int_val = 0;
+        // intensity-weighted sums of the interior offsets for the centroid (constant offsets, no extra loads)
+        uint32_t weight = 0;
+        int32_t sum_x = 0;
+        int32_t sum_y = 0;
+//$ """)
+
+//$ for i, (y, x) in enumerate(FIMD_INTERIOR):
+//$     GEN_OUTPUT.append(("""
+        // interior pixel #%d compare with latest peak
+        curr_int_val = PIXEL(FIMD_INTERIOR_PTxx);
+        if (curr_int_val > peak) {
+            peak = curr_int_val;
+            peak_x = FIMD_INTERIOR_X;
+            peak_y = FIMD_INTERIOR_Y;
+        }
+        weight += curr_int_val;
+        sum_x += (int32_t) curr_int_val * FIMD_INTERIOR_X;
+        sum_y += (int32_t) curr_int_val * FIMD_INTERIOR_Y;
+        FIMD_SCAN_SUPPRESS(suppressed, center_index + FIMD_INTERIOR_PTxx);
+//$     """ % (i)).replace("FIMD_INTERIOR_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)).replace("FIMD_INTERIOR_X", "(%d)" % (x)).replace("FIMD_INTERIOR_Y", "(%d)" % (y)))
+
+//$ GEN_OUTPUT.append("""
+        // extend the range of the suppressed pixels (the interior lies in [center_index, center_index + FIMD_OFFSET))
+        if (suppressed_begin == suppressed_end || center_index < suppressed_begin) suppressed_begin = center_index;
+        if (center_index + FIMD_OFFSET > suppressed_end) suppressed_end = center_index + FIMD_OFFSET;
+
+        // store peak coordinates as marker detection (the peak offset may wrap around the row end or start)
+        UPDATE_ROW();
+        int32_t center_x = (int32_t) (img_ptr - (row_end - IM_STRIDE));
+        peak_x += center_x;
+        peak_y += (int32_t) row;
+        if (peak_x >= IM_STRIDE) {
+            peak_x -= IM_STRIDE;
+            peak_y++;
+        } else if (peak_x < 0) {
+            peak_x += IM_STRIDE;
+            peak_y--;
+        }
+        markers[markers_num].x = (uint16_t) peak_x;
+        markers[markers_num].y = (uint16_t) peak_y;
+        if (centroids) {
+            fimd_scan_store_centroid(&centroids[markers_num], peak_x, peak_y, center_x, (int32_t) row, weight, sum_x, sum_y);
+        }
+        markers_num++;
+    }
+    if (markers_num >= markers_max) goto DONE;
+    goto LOOP;
+
+DONE:
+    scan->suppressed_begin = suppressed_begin;
+    scan->suppressed_end = suppressed_end;
+    scan->markers_num = markers_num;
+    scan->sun_pts_num = sun_pts_num;
+    return img_ptr;
+}
+//$ """)
@@ -0,0 +1,157 @@
+//$ GEN_OUTPUT.append("""
+/**
+ * \\file fimd_fused_w%d.c
+ * \\author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \\date December 2024
+ * \\brief Generated source file for the FIMD-CPU library (fused multi-radius kernel for radii %s).
+ * \\copyright GNU Public License.
+ */
+//$ """ % (FIMD_STRIDE, ", ".join(str(r) for r in FIMD_RADII)))
+//$ GEN_OUTPUT.append("""
+#include <stdint.h>
+
+#include "fimd_simd.h"
+#include "fimd_thresholds.h"
+
+#define IM_STRIDE 0 // placeholder
+#define FIMD_RADIUS_MIN 0 // placeholder
+#define FIMD_OFFSET ((IM_STRIDE * FIMD_RADIUS_MIN) + FIMD_RADIUS_MIN)
+#define FIMD_OFFSET_R(_r) ((IM_STRIDE * (_r)) + (_r))
+#define ADD_TERM_SEQ(_ptr) (*((uint16_t*) ((_ptr) + FIMD_OFFSET)) = FIMD_TERM_SEQ)
+#define CHECK_TERM_SEQ(_ptr) *((uint16_t*) ((_ptr) + FIMD_OFFSET)) == FIMD_TERM_SEQ
+//$ """.replace("IM_STRIDE 0", "IM_STRIDE %d" % (FIMD_STRIDE)).replace("FIMD_RADIUS_MIN 0", "FIMD_RADIUS_MIN %d" % (FIMD_RADII[0])))
+
+//$ GEN_OUTPUT.append("""
+uint8_t* FIMD_KERNEL_NAME(FIMD_FUNC)(uint8_t* img_ptr, uint8_t* img_end, uintptr_t* markers, uint8_t* markers_radii, uint32_t* markers_num, uintptr_t* sun_pts, uint8_t* sun_pts_radii, uint32_t* sun_pts_num)
+{
+    // thresholds kept in registers during the whole scan (see fimd_thresholds.h)
+    const uint8_t threshold_center = fimd_cpu_thresholds.center;
+    const uint8_t threshold_diff = fimd_cpu_thresholds.diff;
+    const uint8_t threshold_sun = fimd_cpu_thresholds.sun;
+
+    // image limits for the radii larger than the smallest one
+    // (the caller writes the termination sequence into the last two pixels of the image, right before img_end)
+    uint8_t* img_begin = img_ptr;
+
+    // initial shift by central pixel offset (smallest radius) - 1
+    img_ptr = (uint8_t*) (img_ptr + (FIMD_OFFSET-1));
+    uint8_t pix_val;
+
+#if FIMD_SIMD_WIDTH
+    // last position for the vector skip-ahead scan (reads up to img_ptr + FIMD_OFFSET + FIMD_SIMD_WIDTH)
+    uint8_t* simd_end = img_end - (FIMD_OFFSET + FIMD_SIMD_WIDTH);
+#endif
+
+LOOP:
+#if FIMD_SIMD_WIDTH
+    // skip ahead over the dark pixels, stop right before the first candidate pixel or termination sequence
+    while (img_ptr < simd_end) {
+        fimd_simd_mask_t stop_mask = fimd_simd_stop_mask(img_ptr + 1, img_ptr + FIMD_OFFSET, threshold_center);
+        if (stop_mask) {
+            img_ptr += FIMD_SIMD_CTZ(stop_mask);
+            break;
+        }
+        img_ptr += FIMD_SIMD_WIDTH;
+    }
+#endif
+
+    // check for the presence of the termination sequence
+    if (CHECK_TERM_SEQ(img_ptr)) return img_ptr;
+
+    // load new pixel value from pre-incremented address (centre test is evaluated only once for all radii)
+    pix_val = *((uint8_t*) (++img_ptr));
+    if (pix_val <= threshold_center) goto LOOP;
+//$ """.replace("FIMD_FUNC", "fimd_fused_w%d" % (FIMD_STRIDE)))
+
+//$ for j, radius in enumerate(FIMD_RADII):
+//$     NEXT_LABEL = "RADIUS_%d" % FIMD_RADII[j+1] if j+1 < len(FIMD_RADII) else "LOOP"
+//$     GEN_OUTPUT.append(("""
+// testing radius FIMD_R (radii are tested in ascending order, the first matching radius is reported)
+//$     """).replace("FIMD_R", str(radius)))
+//$     if j > 0:
+//$         GEN_OUTPUT.append(("""
+RADIUS_FIMD_R:
+    // skip the centres outside of the scanned range of this radius
+    if (((uintptr_t) (img_ptr - img_begin)) < FIMD_OFFSET_R(FIMD_R) || ((uintptr_t) (img_end - img_ptr)) <= (FIMD_OFFSET_R(FIMD_R) + 1)) goto NEXT_LABEL;
+//$         """).replace("FIMD_R", str(radius)).replace("NEXT_LABEL", NEXT_LABEL))
+//$     GEN_OUTPUT.append(("""
+    // first boundary pixel test - decide between MARKER_TEST and SUN_TEST
+    if ((pix_val - *((uint8_t*) (img_ptr + FIMD_BOUNDARY_PTxx))) <= threshold_diff) {
+        if (pix_val >= threshold_sun) goto SUN_TEST_FIMD_R;
+    } else {
+        goto MARKER_TEST_FIMD_R;
+    }
+
+    // otherwise try the next radius
+    goto NEXT_LABEL;
+
+// testing for sun potential
+SUN_TEST_FIMD_R:
+    // check the current number of the detected sun points
+    if (*sun_pts_num == FIMD_MAX_SUN_PTS_COUNT) {
+        ADD_TERM_SEQ(img_ptr);
+        goto LOOP;
+    }
+//$     """).replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % FIMD_BOUNDARIES[radius][0]).replace("FIMD_R", str(radius)).replace("NEXT_LABEL", NEXT_LABEL))
+
+//$     for i, (y, x) in enumerate(FIMD_BOUNDARIES_SUN[radius][1:]):
+//$         GEN_OUTPUT.append(("""
+    // boundary pixel #%d, compare difference from central pixel
+    if ((pix_val - *((uint8_t*) (img_ptr + FIMD_BOUNDARY_PTxx))) > threshold_diff) goto NEXT_LABEL;
+//$         """ % (i+1)).replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)).replace("NEXT_LABEL", NEXT_LABEL))
+
+//$     for i, (y, x) in enumerate(FIMD_INTERIORS[radius]):
+//$         GEN_OUTPUT.append(("""
+    // interior pixel #%d set to 0
+    *((uint8_t*) (img_ptr + FIMD_INTERIOR_PTxx)) = 0x00;
+//$         """ % (i)).replace("FIMD_INTERIOR_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)))
+
+//$     GEN_OUTPUT.append(("""
+    // store current pixel address and radius as sun detection
+    sun_pts[*sun_pts_num] = (uintptr_t) img_ptr;
+    sun_pts_radii[*sun_pts_num] = FIMD_R;
+    (*sun_pts_num)++;
+    goto LOOP;
+
+// testing for marker potential
+MARKER_TEST_FIMD_R:
+//$     """).replace("FIMD_R", str(radius)))
+
+//$     for i, (y, x) in enumerate(FIMD_BOUNDARIES[radius][1:]):
+//$         GEN_OUTPUT.append(("""
+    // boundary pixel #%d, compare difference from central pixel
+    if (pix_val - (*((uint8_t*) (img_ptr + FIMD_BOUNDARY_PTxx))) <= threshold_diff) goto NEXT_LABEL;
+//$         """ % (i+1)).replace("FIMD_BOUNDARY_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)).replace("NEXT_LABEL", NEXT_LABEL))
+
+//$     GEN_OUTPUT.append("""
+    // marker potential preserved, search for peak in interior
+    {
+        uint8_t peak = 0;
+        uintptr_t peak_ptr = 0;
+        uint8_t* curr_int_ptr = 0;
+//$     """)
+
+//$     for i, (y, x) in enumerate(FIMD_INTERIORS[radius]):
+//$         GEN_OUTPUT.append(("""
+        // interior pixel #%d compare with latest peak
+        curr_int_ptr = (uint8_t*) (img_ptr + FIMD_INTERIOR_PTxx);
+        if (*curr_int_ptr > peak) {
+            peak = *curr_int_ptr;
+            peak_ptr = (uintptr_t) curr_int_ptr;
+        }
+        *curr_int_ptr = 0;
+//$         """ % (i)).replace("FIMD_INTERIOR_PTxx", "(((%d)*(IM_STRIDE))+(%d))" % (y, x)))
+
+//$     GEN_OUTPUT.append(("""
+        // store peak address and radius as marker detection
+        markers[*markers_num] = peak_ptr;
+        markers_radii[*markers_num] = FIMD_R;
+        (*markers_num)++;
+    }
+    if (*markers_num == FIMD_MAX_MARKERS_COUNT) ADD_TERM_SEQ(img_ptr);
+    goto LOOP;
+//$     """).replace("FIMD_R", str(radius)))
+
+//$ GEN_OUTPUT.append("""
+}
+//$ """)
@@ -0,0 +1,54 @@
+//$ GEN_OUTPUT.append("""
+/**
+ * \\file fimd_kernels_w%d.c
+ * \\author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \\date December 2024
+ * \\brief Generated source file for the FIMD-CPU library (kernel set for the row pitch of %d bytes, radii %s).
+ * \\copyright GNU Public License.
+ */
+//$ """ % (FIMD_STRIDE, FIMD_STRIDE, ", ".join(str(r) for r in FIMD_RADII)))
+//$ GEN_OUTPUT.append("""
+#include <stdint.h>
+
+#include "fimd_kernels.h"
+#include "fimd_simd.h"
+//$ """)
+
+//$ for radius in FIMD_RADII:
+//$     GEN_OUTPUT.append(("""
+extern uint8_t* FIMD_KERNEL_NAME(fimd_rR_wS)(uint8_t* img_ptr, uint8_t* img_end, uintptr_t* markers, uint32_t* markers_num, uintptr_t* sun_pts, uint32_t* sun_pts_num);
+extern const uint8_t* FIMD_KERNEL_NAME(fimd_bounded_rR_wS)(fimd_scan_t* scan);
+//$     """).replace("rR_", "r%d_" % (radius)).replace("wS", "w%d" % (FIMD_STRIDE)))
+
+//$ GEN_OUTPUT.append("""
+// kernels with 16-bit pixels (generated only with FIMD_PIXELS_16)
+#ifdef FIMD_PIXELS_16
+//$ """)
+
+//$ for radius in FIMD_RADII:
+//$     GEN_OUTPUT.append(("""
+extern uint16_t* FIMD_KERNEL_NAME(fimd_rR_wS_p16)(uint16_t* img_ptr, uint16_t* img_end, const fimd_thresholds16_t* thresholds, uintptr_t* markers, uint32_t* markers_num, uintptr_t* sun_pts, uint32_t* sun_pts_num);
+//$     """).replace("rR_", "r%d_" % (radius)).replace("wS", "w%d" % (FIMD_STRIDE)))
+
+//$ GEN_OUTPUT.append(("""
+#define FIMD_SET_P16 { P16 }
+#else
+#define FIMD_SET_P16 { 0 }
+#endif
+//$ """).replace("P16 }", "%s }" % (", ".join("FIMD_KERNEL_NAME(fimd_r%d_w%d_p16)" % (r, FIMD_STRIDE) for r in FIMD_RADII))))
+
+//$ GEN_OUTPUT.append(("""
+extern uint8_t* FIMD_KERNEL_NAME(fimd_fused_wS)(uint8_t* img_ptr, uint8_t* img_end, uintptr_t* markers, uint8_t* markers_radii, uint32_t* markers_num, uintptr_t* sun_pts, uint8_t* sun_pts_radii, uint32_t* sun_pts_num);
+
+const fimd_kernel_set_t FIMD_KERNEL_NAME(fimd_kernels_wS) = {
+    S,
+    { RADII },
+    { KERNELS },
+    FIMD_KERNEL_NAME(fimd_fused_wS),
+    { BOUNDED },
+    FIMD_SET_P16,
+};
+//$ """).replace("RADII", ", ".join(str(r) for r in FIMD_RADII))
+//$     .replace("KERNELS", ", ".join("FIMD_KERNEL_NAME(fimd_r%d_wS)" % (r) for r in FIMD_RADII))
+//$     .replace("BOUNDED", ", ".join("FIMD_KERNEL_NAME(fimd_bounded_r%d_wS)" % (r) for r in FIMD_RADII))
+//$     .replace("wS", "w%d" % (FIMD_STRIDE)).replace("    S,", "    %d," % (FIMD_STRIDE)))
@@ -0,0 +1,163 @@
+/**
+ * \file test_jit.c
+ * \author Vojtech Vrba (vrba.vojtech [at] fel.cvut.cz)
+ * \date December 2024
+ * \brief Test of the FIMD-CPU kernels emitted at runtime against the generated kernels.
+ * \copyright GNU Public License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "fimd_cpu.h"
+
+// extra row pitch of the compared context, which has no generated kernels (the kernels are emitted at runtime)
+#define TEST_JIT_STRIDE_PADDING 48
+
+// number of synthetic frames used without the frame files
+#define TEST_JIT_SYNTHETIC_FRAMES 8
+
+
+static uint32_t test_jit_random(uint32_t* state)
+{
+    // xorshift32, the synthetic frames are the same in every run
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// noise with bright clutter, isolated bright points (markers of all radii), bright discs of various sizes
+// and a saturated glare region (sun points)
+static void test_jit_synthetic_frame(unsigned char* image, unsigned width, unsigned height, unsigned seed)
+{
+    uint32_t state = 2463534242u + seed;
+    for (unsigned i = 0; i < width * height; i++) {
+        uint32_t value = test_jit_random(&state);
+        image[i] = (value % 8192 == 0) ? 100 + value % 100 : value % 60;
+    }
+    for (unsigned k = 0; k < 120; k++) {
+        unsigned x = test_jit_random(&state) % width;
+        unsigned y = test_jit_random(&state) % height;
+        unsigned size = test_jit_random(&state) % 6;
+        unsigned char value = 130 + test_jit_random(&state) % 126;
+        for (unsigned dy = 0; dy <= size && y + dy < height; dy++) {
+            for (unsigned dx = 0; dx <= size && x + dx < width; dx++) {
+                image[(y + dy) * width + x + dx] = value;
+            }
+        }
+    }
+    unsigned glare_x = test_jit_random(&state) % (width / 2);
+    unsigned glare_y = test_jit_random(&state) % (height / 2);
+    for (unsigned y = glare_y; y < glare_y + 40; y++) {
+        memset(image + y * width + glare_x, 250, 60);
+    }
+}
+
+// compares the detections of all compiled radii for all instruction set variants supported by the CPU,
+// returns the number of mismatches
+static unsigned test_jit_compare(fimd_cpu_ctx_t* ctx, const unsigned char* image, fimd_cpu_ctx_t* ctx_jit, const unsigned char* image_jit, unsigned* compared)
+{
+    unsigned markers[fimd_cpu_get_max_markers_count()][2];
+    unsigned sun_pts[fimd_cpu_get_max_sun_points_count()][2];
+    unsigned markers_jit[fimd_cpu_get_max_markers_count()][2];
+    unsigned sun_pts_jit[fimd_cpu_get_max_sun_points_count()][2];
+    unsigned markers_num = 0, sun_pts_num = 0, markers_jit_num = 0, sun_pts_jit_num = 0;
+    unsigned mismatches = 0;
+
+    const char* isa = fimd_cpu_get_isa();
+    const char* isa_names[] = { isa, "scalar", "sse4.1", "avx2", "avx512" };
+    for (unsigned j = 0; j < sizeof(isa_names) / sizeof(isa_names[0]); j++) {
+        if ((j > 0 && strcmp(isa_names[j], isa) == 0) || fimd_cpu_set_isa(isa_names[j]) != 0) {
+            continue;
+        }
+        for (unsigned i = 0; i < fimd_cpu_get_radii_count(); i++) {
+            unsigned radius = fimd_cpu_get_radii()[i];
+            int result = fimd_cpu_ctx_detect(ctx, radius, image, markers, &markers_num, sun_pts, &sun_pts_num);
+            int result_jit = fimd_cpu_ctx_detect(ctx_jit, radius, image_jit, markers_jit, &markers_jit_num, sun_pts_jit, &sun_pts_jit_num);
+            int match = result == result_jit && markers_num == markers_jit_num && sun_pts_num == sun_pts_jit_num
+                        && memcmp(markers, markers_jit, markers_num * sizeof(markers[0])) == 0
+                        && memcmp(sun_pts, sun_pts_jit, sun_pts_num * sizeof(sun_pts[0])) == 0;
+            if (!match) {
+                fprintf(stderr, "FIMD-CPU JIT r=%u (%s): ERROR - %u marker(s), %u sun point(s) instead of %u, %u\n", radius, isa_names[j], markers_jit_num, sun_pts_jit_num, markers_num, sun_pts_num);
+                mismatches++;
+            }
+            (*compared)++;
+        }
+    }
+    fimd_cpu_set_isa(isa);
+    return mismatches;
+}
+
+
+int main(int argc, char *argv[]) {
+    unsigned width = fimd_cpu_image_width();
+    unsigned height = fimd_cpu_image_height();
+    unsigned stride = fimd_cpu_image_stride();
+    unsigned jit_stride = stride + TEST_JIT_STRIDE_PADDING;
+
+    // the compiled resolution runs on the generated kernels, the padded one on the emitted kernels
+    fimd_cpu_ctx_t* ctx = fimd_cpu_ctx_create();
+    fimd_cpu_ctx_t* ctx_jit = fimd_cpu_ctx_create_resolution(width, height, jit_stride);
+    unsigned char* frame = (unsigned char *) malloc(width * height);
+    unsigned char* image = (unsigned char *) calloc(stride * height, sizeof(unsigned char));
+    unsigned char* image_jit = (unsigned char *) calloc(jit_stride * height, sizeof(unsigned char));
+    if (!ctx || !ctx_jit || !frame || !image || !image_jit) {
+        fprintf(stderr, "FIMD-CPU JIT: ERROR - pitch %u not supported or allocation failed\n", jit_stride);
+        fimd_cpu_ctx_destroy(ctx_jit);
+        fimd_cpu_ctx_destroy(ctx);
+        free(frame);
+        free(image);
+        free(image_jit);
+        return EXIT_FAILURE;
+    }
+
+    unsigned radius_max = 0;
+    for (unsigned i = 0; i < fimd_cpu_get_radii_count(); i++) {
+        radius_max = (fimd_cpu_get_radii()[i] > radius_max) ? fimd_cpu_get_radii()[i] : radius_max;
+    }
+
+    // raw frames of the compiled resolution given as the arguments, or the synthetic frames
+    unsigned frames_count = (argc > 1) ? (unsigned) (argc - 1) : TEST_JIT_SYNTHETIC_FRAMES;
+    unsigned mismatches = 0;
+    unsigned compared = 0;
+    unsigned unread = 0;
+    for (unsigned f = 0; f < frames_count; f++) {
+        if (argc > 1) {
+            FILE* file = fopen(argv[f + 1], "rb");
+            if (!file || fread(frame, sizeof(unsigned char), width * height, file) != width * height) {
+                fprintf(stderr, "FIMD-CPU JIT: ERROR - cannot read %s\n", argv[f + 1]);
+                unread++;
+                if (file) {
+                    fclose(file);
+                }
+                continue;
+            }
+            fclose(file);
+        } else {
+            test_jit_synthetic_frame(frame, width, height, f);
+        }
+
+        // the columns within the largest radius from the left and right border are cleared (the circles
+        // of the border columns read the neighbouring rows without the padding, but the padding with it)
+        for (unsigned row = 0; row < height; row++) {
+            memset(frame + row * width, 0, radius_max);
+            memset(frame + row * width + width - radius_max, 0, radius_max);
+            memcpy(image + row * stride, frame + row * width, width);
+            memcpy(image_jit + row * jit_stride, frame + row * width, width);
+        }
+        mismatches += test_jit_compare(ctx, image, ctx_jit, image_jit, &compared);
+    }
+
+    printf("FIMD-CPU JIT: pitch %u matches the generated kernels in %u of %u detections.\n", jit_stride, compared - mismatches, compared);
+
+    fimd_cpu_ctx_destroy(ctx_jit);
+    fimd_cpu_ctx_destroy(ctx);
+    free(frame);
+    free(image);
+    free(image_jit);
+
+    return (mismatches > 0 || unread > 0 || compared == 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
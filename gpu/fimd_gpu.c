@@ -22,7 +22,7 @@ struct fimd_gpu_inst_s {
     compute_lib_program_t compute_prog;
     compute_lib_ssbo_t image_in_ssbo;
     compute_lib_acbo_t markers_count_acbo, sun_pts_count_acbo;
-    compute_lib_ssbo_t configuration_ssbo, markers_ssbo, sun_pts_ssbo;
+    compute_lib_ssbo_t configuration_ssbo, markers_ssbo, sun_pts_ssbo, defects_ssbo;
     uint32_t local_size_x, local_size_y;
 };
 
@@ -47,7 +47,8 @@ fimd_gpu_t* fimd_gpu_init(unsigned image_width, unsigned image_height, unsigned
         .threshold_diff = threshold_diff,
         .threshold_sun = threshold_sun,
         .radii_count = radii_count,
-        .radii = {0}
+        .radii = {0},
+        .defects_count = 0
     };
     for (unsigned i = 0; i < radii_count; i++) {
         handle->config.radii[i] = radii[i];
@@ -116,9 +117,13 @@ fimd_gpu_t* fimd_gpu_init(unsigned image_width, unsigned image_height, unsigned
     fimd_gpu_inst->sun_pts_ssbo = COMPUTE_LIB_SSBO_NEW("sun_pts_buffer", GL_UNSIGNED_INT, GL_DYNAMIC_DRAW);
     fimd_gpu_inst->sun_pts_ssbo.resource.value = 6;
 
+    fimd_gpu_inst->defects_ssbo = COMPUTE_LIB_SSBO_NEW("defects_buffer", GL_UNSIGNED_INT, GL_DYNAMIC_DRAW);
+    fimd_gpu_inst->defects_ssbo.resource.value = 7;
+
     fimd_gpu_inst->compute_prog = COMPUTE_LIB_PROGRAM_NEW(&fimd_gpu_inst->compute_lib, NULL, fimd_gpu_inst->local_size_x, fimd_gpu_inst->local_size_y, 1);
 
-    if(asprintf(&(fimd_gpu_inst->compute_prog.source), _binary_shader_comp_start, "asprintf:\n", fimd_gpu_inst->local_size_x, fimd_gpu_inst->local_size_y) < 0) {
+    if(asprintf(&(fimd_gpu_inst->compute_prog.source), _binary_shader_comp_start, "asprintf:\n", fimd_gpu_inst->local_size_x, fimd_gpu_inst->local_size_y,
+                "asprintf:\n", (int) FIMD_GPU_CONFIG_RADII, "asprintf:\n", (int) FIMD_GPU_CONFIG_DEFECTS_COUNT) < 0) {
         fprintf(stderr, "ERROR: Failed to format shader source!\r\n");
         return NULL;
     }
@@ -179,6 +184,16 @@ fimd_gpu_t* fimd_gpu_init(unsigned image_width, unsigned image_height, unsigned
         return NULL;
     }
 
+    // empty map of the defects (the shader reads it only if the defects are set)
+    uint32_t no_defects = 0;
+    error = compute_lib_ssbo_init(&(fimd_gpu_inst->defects_ssbo), (void *) &no_defects, 1);
+    if (error != GL_NO_ERROR) {
+        fprintf(stderr, "ERROR: Failed to init ssbo '%s'!\r\n", fimd_gpu_inst->defects_ssbo.resource.name);
+        compute_lib_error_queue_flush(&fimd_gpu_inst->compute_lib, stderr);
+        fimd_gpu_destroy(handle);
+        return NULL;
+    }
+
     return handle;
 }
 
@@ -333,6 +348,40 @@ detect_end:
     return error;
 }
 
+unsigned fimd_gpu_set_defects(fimd_gpu_t* handle, const unsigned defects[][2], unsigned defects_count)
+{
+    struct fimd_gpu_inst_s* fimd_gpu_inst = (struct fimd_gpu_inst_s*) handle->inst_handle;
+    unsigned words_count = (handle->config.image_width * handle->config.image_height + 31) / 32;
+    unsigned error = 0;
+
+    for (unsigned i = 0; i < defects_count; i++) {
+        if (defects[i][0] >= handle->config.image_width || defects[i][1] >= handle->config.image_height) {
+            return GL_INVALID_VALUE;
+        }
+    }
+
+    // one bit per pixel in the row order
+    uint32_t* bitmap = (uint32_t*) calloc(words_count + 1, sizeof(uint32_t));
+    if (!bitmap) {
+        fprintf(stderr, "ERROR: Failed to allocate memory for the defects!\r\n");
+        return GL_OUT_OF_MEMORY;
+    }
+    for (unsigned i = 0; i < defects_count; i++) {
+        unsigned index = defects[i][1] * handle->config.image_width + defects[i][0];
+        bitmap[index / 32] |= 1U << (index % 32);
+    }
+
+    error = compute_lib_ssbo_write(&fimd_gpu_inst->defects_ssbo, (void *) bitmap, (GLint) ((defects_count > 0) ? words_count : 1));
+    free(bitmap);
+    if (error != GL_NO_ERROR) {
+        fprintf(stderr, "ERROR: Failed to write defects ssbo! Code: %d\r\n", error);
+        return error;
+    }
+    handle->config.defects_count = defects_count;
+
+    return 0;
+}
+
 void fimd_gpu_destroy(fimd_gpu_t* handle)
 {
     struct fimd_gpu_inst_s* fimd_gpu_inst = (struct fimd_gpu_inst_s*) handle->inst_handle;
@@ -342,6 +391,7 @@ void fimd_gpu_destroy(fimd_gpu_t* handle)
     compute_lib_ssbo_destroy(&(fimd_gpu_inst->configuration_ssbo));
     compute_lib_ssbo_destroy(&(fimd_gpu_inst->markers_ssbo));
     compute_lib_ssbo_destroy(&(fimd_gpu_inst->sun_pts_ssbo));
+    compute_lib_ssbo_destroy(&(fimd_gpu_inst->defects_ssbo));
     compute_lib_program_destroy(&(fimd_gpu_inst->compute_prog), GL_TRUE);
     compute_lib_deinit(&fimd_gpu_inst->compute_lib);
     free(fimd_gpu_inst);
@@ -352,10 +402,14 @@ void fimd_gpu_destroy(fimd_gpu_t* handle)
 void fimd_gpu_set_image_width(fimd_gpu_t* handle, unsigned image_width)
 {
     handle->config.image_width = image_width;
+    // the bitmap of the defects indexes the pixels of the previous size
+    fimd_gpu_set_defects(handle, NULL, 0);
 }
 void fimd_gpu_set_image_height(fimd_gpu_t* handle, unsigned image_height)
 {
     handle->config.image_height = image_height;
+    // the bitmap of the defects indexes the pixels of the previous size
+    fimd_gpu_set_defects(handle, NULL, 0);
 }
 void fimd_gpu_set_threshold(fimd_gpu_t* handle, unsigned threshold)
 {
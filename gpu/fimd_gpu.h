@@ -11,8 +11,16 @@
 #ifndef FIMD_GPU_H
 #define FIMD_GPU_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+// maximum number of the radii in the configuration
+#define FIMD_GPU_MAX_RADII 64
+
+// indices of the configuration words read by the shader after the fixed fields (passed to the shader source as defines)
+#define FIMD_GPU_CONFIG_RADII (offsetof(struct fimd_gpu_config_s, radii) / sizeof(uint32_t))
+#define FIMD_GPU_CONFIG_DEFECTS_COUNT (offsetof(struct fimd_gpu_config_s, defects_count) / sizeof(uint32_t))
+
 struct fimd_gpu_config_s {
     uint32_t image_width;
     uint32_t image_height;
@@ -22,7 +30,8 @@ struct fimd_gpu_config_s {
     uint32_t max_markers_count;
     uint32_t max_sun_pts_count;
     uint32_t radii_count;
-    uint32_t radii[64];
+    uint32_t radii[FIMD_GPU_MAX_RADII];
+    uint32_t defects_count;
 };
 
 typedef struct fimd_gpu_handle_s {
@@ -58,6 +67,18 @@ fimd_gpu_t* fimd_gpu_init(unsigned image_width, unsigned image_height, unsigned
  */
 unsigned fimd_gpu_detect(fimd_gpu_t* handle, unsigned char* image, unsigned markers[][2], unsigned* markers_count, unsigned sun_pts[][2], unsigned* sun_pts_count);
 
+/**
+ * \brief Sets the static map of the defective pixels (hot, stuck or dead pixels) of the sensor.
+ *
+ * The defects are uploaded as a bitmap and read as zero by the shader, so the results equal the detection
+ * in the image with the defects set to zero. The bitmap is only read for the pixels above zero.
+ * \param handle Pointer to the FIMD-GPU instance.
+ * \param defects Array of the defect coordinates (x, y) within the current image size.
+ * \param defects_count Number of the defects, 0 clears the map.
+ * \return 0 on success, non-zero on failure (GL_INVALID_VALUE for coordinates outside the image).
+ */
+unsigned fimd_gpu_set_defects(fimd_gpu_t* handle, const unsigned defects[][2], unsigned defects_count);
+
 /**
  * \brief Destroys the FIMD-GPU instance and releases associated resources.
  * \param handle Pointer to the FIMD-GPU instance.
@@ -65,6 +86,8 @@ unsigned fimd_gpu_detect(fimd_gpu_t* handle, unsigned char* image, unsigned mark
 void fimd_gpu_destroy(fimd_gpu_t* handle);
 /**
  * \brief Sets the image width for the FIMD-GPU instance.
+ *
+ * The defect map is cleared, since its bitmap is laid out for the previous image size.
  * \param handle Pointer to the FIMD-GPU instance.
  * \param image_width New image width.
  */
@@ -72,6 +95,8 @@ void fimd_gpu_set_image_width(fimd_gpu_t* handle, unsigned image_width);
 
 /**
  * \brief Sets the image height for the FIMD-GPU instance.
+ *
+ * The defect map is cleared, since its bitmap is laid out for the previous image size.
  * \param handle Pointer to the FIMD-GPU instance.
  * \param image_height New image height.
  */
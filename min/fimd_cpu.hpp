@@ -9,12 +9,15 @@
 #ifndef FIMD_CPU_HPP
 #define FIMD_CPU_HPP
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <limits>
 #include <list>
 #include <type_traits>
+#include <vector>
 
 
 namespace fimd {
@@ -551,6 +554,100 @@ public:
             goto LOOP;
     };
 
+    /**
+     * \brief Detects markers and sun points in a read-only image (no copy, the image is not modified).
+     *
+     * The interior pixels of the detections are suppressed in a bitmap owned by the detector (1 bit per pixel)
+     * instead of being zeroed, the suppressed pixels read as zero in the tests. No termination sequence is written,
+     * the central pixels are scanned up to the same position, so the results equal detect() except for the circles
+     * reaching the last pixels of the image. Several detectors (e.g., of different radii) can thus process
+     * the same image concurrently, each one in its own thread.
+     * \param image The image data (array of pixels).
+     * \param markers The list of detected markers (2D points).
+     * \param sun_points The list of detected sun points (2D points).
+     * \return The total number of processed pixels in the input image.
+     */
+    unsigned detect_const(const PIXEL* image, std::list<Point2D> &markers, std::list<Point2D> &sun_points) {
+        if (im_width_ < (2*RADIUS+1) or im_height_ < (2*RADIUS+1)) {
+            return 0;
+        }
+
+        const size_t image_size = im_width_ * im_height_;
+        if (suppressed_.size() != (image_size + 7) / 8) {
+            suppressed_.assign((image_size + 7) / 8, 0);
+        }
+
+        // range of the suppressed pixels, only this part of the bitmap is cleared afterwards
+        size_t suppressed_begin = image_size;
+        size_t suppressed_end = 0;
+
+        auto pixel = [&](const size_t pos) -> PIXEL {
+            return ((suppressed_[pos >> 3] >> (pos & 7)) & 1) ? 0x00 : image[pos];
+        };
+        auto suppress = [&](const size_t pos) {
+            suppressed_[pos >> 3] |= static_cast<uint8_t>(1 << (pos & 7));
+            suppressed_begin = std::min(suppressed_begin, pos);
+            suppressed_end = std::max(suppressed_end, pos + 1);
+        };
+
+        // the same central pixels as in detect() up to the termination sequence at the end of the image
+        const size_t end = image_size - offset_;
+        size_t cursor = offset_ + 1;
+        for (; cursor <= end; cursor++) {
+            PIXEL pix_val = pixel(cursor);
+            if (pix_val <= threshold_center_) continue;
+
+            // first boundary pixel test - decide between MARKER_TEST and SUN_TEST
+            if ((pix_val - pixel(cursor + coord2to1(boundary[0], im_width_))) > threshold_diff_) {
+                // MARKER_TEST: testing of the boundary pixels
+                if (boundary_unroll([&](const Point2D point) -> bool {
+                    return (pix_val - pixel(cursor + coord2to1(point, im_width_))) <= threshold_diff_;
+                })) continue;
+
+                // search for a peak in the interior
+                PIXEL peak = 0;
+                size_t peak_pos = 0;
+                interior_unroll([&](const Point2D point) -> bool {
+                    size_t pos = cursor + coord2to1(point, im_width_);
+                    if (pixel(pos) > peak) {
+                        peak = pixel(pos);
+                        peak_pos = pos;
+                    }
+                    suppress(pos);
+                    return false;
+                });
+
+                markers.push_back(coord1to2(peak_pos, im_width_));
+                if (markers.size() == max_markers_count_) {
+                    cursor++;
+                    break;
+                }
+            } else if (pix_val >= threshold_sun_) {
+                // SUN_TEST: testing of the boundary pixels
+                if (boundary_unroll([&](const Point2D point) -> bool {
+                    return (pix_val - pixel(cursor + coord2to1(point, im_width_))) > threshold_diff_;
+                })) continue;
+
+                interior_unroll([&](const Point2D point) -> bool {
+                    suppress(cursor + coord2to1(point, im_width_));
+                    return false;
+                });
+
+                sun_points.push_back(coord1to2(cursor, im_width_));
+                if (sun_points.size() == max_sun_points_count_) {
+                    cursor++;
+                    break;
+                }
+            }
+        }
+
+        if (suppressed_begin < suppressed_end) {
+            std::fill(suppressed_.begin() + (suppressed_begin >> 3), suppressed_.begin() + ((suppressed_end + 7) >> 3), 0);
+        }
+
+        return cursor - 1 - offset_;
+    };
+
     /**
      * \brief Gets the image width.
      * \return The width of the image.
@@ -677,6 +774,8 @@ private:
     unsigned max_markers_count_;
     unsigned max_sun_points_count_;
     PIXEL* frame_ = nullptr;
+    // suppression bitmap of detect_const() (1 bit per pixel)
+    std::vector<uint8_t> suppressed_;
 
     static constexpr auto boundary = BresenhamBoundary<RADIUS>();
     static constexpr auto interior = BresenhamInterior<RADIUS>();